@@ -130,6 +130,16 @@ int main(int argc, char **argv)
                                         i18n("Add the specified files to 'filename'. Create archive if it does not exist. Quit when finished."),
                                         QStringLiteral("filename")));
 
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("u") << QStringLiteral("update"),
+                                        i18n("Together with --add-to, only add the files which are new or have changed since they were added to the "
+                                             "existing archive.")));
+
+    parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("T") << QStringLiteral("files-from"),
+                                        i18n("Together with --add-to, add the files listed in 'file', separated by NUL characters as written by "
+                                             "\"find -print0\", instead of the specified files. Read the list from the standard input if 'file' is '-'. "
+                                             "Directories are added without their contents."),
+                                        QStringLiteral("file")));
+
     parser.addOption(QCommandLineOption(QStringList() << QStringLiteral("p") << QStringLiteral("changetofirstpath"),
                                         i18n("Change the current dir to the first entry and add all other entries relative to this one.")));
 
@@ -180,10 +190,15 @@ int main(int argc, char **argv)
         const QStringList urls = parser.positionalArguments();
 
         if (parser.isSet(QStringLiteral("add")) || parser.isSet(QStringLiteral("add-to"))) {
-            if (urls.isEmpty()) {
+            const bool hasFileList = parser.isSet(QStringLiteral("files-from"));
+            if (urls.isEmpty() && !hasFileList) {
                 std::cout << "Missing arguments: urls." << std::endl;
                 parser.showHelp(-1);
             }
+            if (hasFileList && (!urls.isEmpty() || !parser.isSet(QStringLiteral("add-to")))) {
+                std::cout << "--files-from requires --add-to and no urls." << std::endl;
+                parser.showHelp(-1);
+            }
 
             AddToArchive *addToArchiveJob = new AddToArchive(&application);
             application.setQuitOnLastWindowClosed(false);
@@ -194,6 +209,16 @@ int main(int argc, char **argv)
                 addToArchiveJob->setChangeToFirstPath(true);
             }
 
+            if (parser.isSet(QStringLiteral("update"))) {
+                qCDebug(ARK_LOG) << "Setting update mode";
+                addToArchiveJob->setUpdateMode(true);
+            }
+
+            if (hasFileList) {
+                qCDebug(ARK_LOG) << "Reading the files to add from" << parser.value(QStringLiteral("files-from"));
+                addToArchiveJob->setFileList(parser.value(QStringLiteral("files-from")));
+            }
+
             if (parser.isSet(QStringLiteral("add-to"))) {
                 qCDebug(ARK_LOG) << "Setting filename to" << parser.value(QStringLiteral("add-to"));
                 addToArchiveJob->setFilename(QUrl::fromUserInput(parser.value(QStringLiteral("add-to")), QDir::currentPath(), QUrl::AssumeLocalFile));
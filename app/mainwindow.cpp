@@ -507,6 +507,9 @@ void MainWindow::newArchive()
         if (!dialog.data()->encryptionMethod().isEmpty()) {
             m_openArgs.metaData()[QStringLiteral("encryptionMethod")] = dialog.data()->encryptionMethod();
         }
+        if (dialog.data()->sortByType()) {
+            m_openArgs.metaData()[QStringLiteral("sortByType")] = QStringLiteral("true");
+        }
 
         m_openArgs.metaData()[QStringLiteral("encryptionPassword")] = password;
 
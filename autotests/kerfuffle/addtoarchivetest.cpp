@@ -11,6 +11,7 @@
 
 #include <QMimeDatabase>
 #include <QStandardPaths>
+#include <QTemporaryDir>
 #include <QTest>
 
 using namespace Kerfuffle;
@@ -31,6 +32,8 @@ private Q_SLOTS:
     void init();
     void testCompressHere_data();
     void testCompressHere();
+    void testCompressFileList_data();
+    void testCompressFileList();
 };
 
 void AddToArchiveTest::init()
@@ -184,6 +187,65 @@ void AddToArchiveTest::testCompressHere()
     archive->deleteLater();
 }
 
+void AddToArchiveTest::testCompressFileList_data()
+{
+    QTest::addColumn<QString>("archiveName");
+    QTest::addColumn<QByteArray>("fileList");
+    QTest::addColumn<qulonglong>("expectedNumberOfEntries");
+
+    // Directories are added without their contents, the list has them already.
+    QTest::newRow("TAR - dir with files") << QStringLiteral("list.tar.gz") << QByteArray("testdir\0testdir/testfile1.txt\0testdir/testfile2.txt\0", 52)
+                                          << 3ULL;
+    QTest::newRow("TAR - dir without its files") << QStringLiteral("list.tar.gz") << QByteArray("testdir\0", 8) << 1ULL;
+    QTest::newRow("TAR - unterminated last path, empty paths")
+        << QStringLiteral("list.tar.gz") << QByteArray("\0testfile.txt\0\0testfile.md", 26) << 2ULL;
+
+    if (!PluginManager().preferredWritePluginsFor(QMimeDatabase().mimeTypeForName(QStringLiteral("application/zip"))).isEmpty()) {
+        // Read as a whole by AddJob.
+        QTest::newRow("ZIP - dir with files") << QStringLiteral("list.zip") << QByteArray("testdir\0testdir/testfile1.txt\0testdir/testfile2.txt\0", 52)
+                                              << 3ULL;
+        QTest::newRow("ZIP - dir without its files") << QStringLiteral("list.zip") << QByteArray("testdir\0", 8) << 1ULL;
+    }
+}
+
+void AddToArchiveTest::testCompressFileList()
+{
+    QTemporaryDir temporaryDir;
+    QFETCH(QByteArray, fileList);
+    QFile listFile(temporaryDir.filePath(QStringLiteral("list")));
+    QVERIFY(listFile.open(QIODevice::WriteOnly));
+    QCOMPARE(listFile.write(fileList), fileList.size());
+    listFile.close();
+
+    // The listed paths are relative to the current directory.
+    const QString oldCurrentDir = QDir::currentPath();
+    QVERIFY(QDir::setCurrent(QFINDTESTDATA("data")));
+
+    QFETCH(QString, archiveName);
+    const QString archivePath = temporaryDir.filePath(archiveName);
+    AddToArchive *addToArchiveJob = new AddToArchive(this);
+    addToArchiveJob->setFilename(QUrl::fromLocalFile(archivePath));
+    addToArchiveJob->setFileList(listFile.fileName());
+    TestHelper::startAndWaitForResult(addToArchiveJob);
+    QDir::setCurrent(oldCurrentDir);
+    QVERIFY(!addToArchiveJob->error());
+
+    auto loadJob = Archive::load(archivePath);
+    QVERIFY(loadJob);
+    loadJob->setAutoDelete(false);
+
+    TestHelper::startAndWaitForResult(loadJob);
+    auto archive = loadJob->archive();
+
+    QVERIFY(archive);
+    QVERIFY(archive->isValid());
+    QFETCH(qulonglong, expectedNumberOfEntries);
+    QCOMPARE(archive->numberOfEntries(), expectedNumberOfEntries);
+
+    loadJob->deleteLater();
+    archive->deleteLater();
+}
+
 QTEST_MAIN(AddToArchiveTest)
 
 #include "addtoarchivetest.moc"
@@ -0,0 +1,111 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "archive_kerfuffle.h"
+#include "jobs.h"
+#include "testhelper.h"
+
+#include <QDirIterator>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace Kerfuffle;
+
+/**
+ * Archives made of several compressed units are decoded in parallel when extracted,
+ * the result must be the same as extracting the same tarball compressed as a single unit.
+ */
+class ParallelDecompressionTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testExtraction_data();
+    void testExtraction();
+
+private:
+    struct ExtractedArchive {
+        uint numberOfEntries = 0;
+        qulonglong unpackedSize = 0;
+        QMap<QString, QByteArray> files;
+    };
+
+    bool extract(const QString &archivePath, ExtractedArchive &extracted);
+};
+
+QTEST_GUILESS_MAIN(ParallelDecompressionTest)
+
+void ParallelDecompressionTest::testExtraction_data()
+{
+    QTest::addColumn<QString>("archivePath");
+
+    // gzip -n of each 1 MiB split of the tarball, concatenated.
+    QTest::newRow("multi-member tar.gz") << QFINDTESTDATA("data/parallel-multimember.tar.gz");
+    // xz -T2 --block-size=1MiB
+    QTest::newRow("multi-block tar.xz") << QFINDTESTDATA("data/parallel-multiblock.tar.xz");
+}
+
+void ParallelDecompressionTest::testExtraction()
+{
+    ExtractedArchive expected;
+    if (!extract(QFINDTESTDATA("data/parallel-singlemember.tar.gz"), expected)) {
+        QSKIP("Could not extract the reference archive. Skipping test.", SkipSingle);
+    }
+    QCOMPARE(expected.files.size(), 3);
+
+    QFETCH(QString, archivePath);
+    ExtractedArchive extracted;
+    QVERIFY(extract(archivePath, extracted));
+
+    QCOMPARE(extracted.numberOfEntries, expected.numberOfEntries);
+    QCOMPARE(extracted.unpackedSize, expected.unpackedSize);
+    QCOMPARE(extracted.files.keys(), expected.files.keys());
+    for (auto it = expected.files.cbegin(); it != expected.files.cend(); ++it) {
+        QVERIFY2(extracted.files.value(it.key()) == it.value(), qPrintable(it.key()));
+    }
+}
+
+bool ParallelDecompressionTest::extract(const QString &archivePath, ExtractedArchive &extracted)
+{
+    auto loadJob = Archive::load(archivePath, this);
+    loadJob->setAutoDelete(false);
+    TestHelper::startAndWaitForResult(loadJob);
+
+    auto archive = loadJob->archive();
+    loadJob->deleteLater();
+    if (!archive || !archive->isValid()) {
+        return false;
+    }
+
+    // Listing reads the archive serially.
+    extracted.numberOfEntries = archive->numberOfEntries();
+    extracted.unpackedSize = archive->unpackedSize();
+
+    QTemporaryDir destDir;
+    auto extractionJob = archive->extractFiles(QList<Archive::Entry *>(), destDir.path(), ExtractionOptions());
+    extractionJob->setAutoDelete(false);
+    TestHelper::startAndWaitForResult(extractionJob);
+    const bool succeeded = extractionJob->error() == KJob::NoError;
+    extractionJob->deleteLater();
+    archive->deleteLater();
+    if (!succeeded) {
+        return false;
+    }
+
+    QDirIterator dirIt(destDir.path(), QDir::Files, QDirIterator::Subdirectories);
+    while (dirIt.hasNext()) {
+        const QString path = dirIt.next();
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            return false;
+        }
+        extracted.files.insert(QDir(destDir.path()).relativeFilePath(path), file.readAll());
+    }
+
+    return true;
+}
+
+#include "paralleldecompressiontest.moc"
@@ -0,0 +1,123 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "volumeset.h"
+
+#include <QFile>
+#include <QTemporaryDir>
+#include <QTest>
+
+using namespace Kerfuffle;
+
+class VolumeSetTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testResolve_data();
+    void testResolve();
+    void testValidate_data();
+    void testValidate();
+};
+
+QTEST_GUILESS_MAIN(VolumeSetTest)
+
+static const QStringList rarSuffixes = {QStringLiteral("part01.$Suffix"), QStringLiteral("part1.$Suffix")};
+static const QStringList sevenZipSuffixes = {QStringLiteral("$Suffix.001")};
+
+void VolumeSetTest::testResolve_data()
+{
+    QTest::addColumn<QString>("archive");
+    QTest::addColumn<QStringList>("suffixPatterns");
+    QTest::addColumn<bool>("isMultiVolume");
+    QTest::addColumn<int>("numberOfVolumes");
+
+    QTest::newRow("first rar volume") << QFINDTESTDATA("data/archive-multivolume.part1.rar") << rarSuffixes << true << 3;
+    QTest::newRow("second rar volume") << QFINDTESTDATA("data/archive-multivolume.part2.rar") << rarSuffixes << true << 3;
+    QTest::newRow("first 7z volume") << QFINDTESTDATA("data/archive-multivolume.7z.001") << sevenZipSuffixes << true << 3;
+    QTest::newRow("single rar") << QFINDTESTDATA("data/test.rar") << rarSuffixes << false << 0;
+    QTest::newRow("7z volume with rar patterns") << QFINDTESTDATA("data/archive-multivolume.7z.001") << rarSuffixes << false << 0;
+}
+
+void VolumeSetTest::testResolve()
+{
+    QFETCH(QString, archive);
+    QFETCH(QStringList, suffixPatterns);
+    QVERIFY(!archive.isEmpty());
+
+    VolumeSet volumeSet(archive, suffixPatterns);
+
+    QFETCH(bool, isMultiVolume);
+    QCOMPARE(volumeSet.isMultiVolume(), isMultiVolume);
+
+    QFETCH(int, numberOfVolumes);
+    QCOMPARE(volumeSet.volumes().size(), numberOfVolumes);
+
+    for (int i = 0; i < numberOfVolumes; ++i) {
+        QVERIFY(QFile::exists(volumeSet.volumes().at(i)));
+        QCOMPARE(volumeSet.indexOf(volumeSet.volumes().at(i)), i);
+    }
+}
+
+void VolumeSetTest::testValidate_data()
+{
+    QTest::addColumn<QString>("opened");
+    QTest::addColumn<QString>("removed");
+    QTest::addColumn<QString>("damaged");
+    QTest::addColumn<VolumeSet::Status>("expectedStatus");
+    QTest::addColumn<QString>("expectedInvalidVolume");
+
+    QTest::newRow("complete") << QStringLiteral("archive-multivolume.part1.rar") << QString() << QString() << VolumeSet::Complete << QString();
+    QTest::newRow("missing volume before the opened one") << QStringLiteral("archive-multivolume.part3.rar") << QStringLiteral("archive-multivolume.part2.rar")
+                                                          << QString() << VolumeSet::MissingVolume << QStringLiteral("archive-multivolume.part2.rar");
+    QTest::newRow("missing volume after the opened one") << QStringLiteral("archive-multivolume.part1.rar") << QStringLiteral("archive-multivolume.part2.rar")
+                                                         << QString() << VolumeSet::MissingVolume << QStringLiteral("archive-multivolume.part2.rar");
+    QTest::newRow("missing last volume") << QStringLiteral("archive-multivolume.part1.rar") << QStringLiteral("archive-multivolume.part3.rar") << QString()
+                                         << VolumeSet::MissingVolume << QStringLiteral("archive-multivolume.part3.rar");
+    QTest::newRow("missing first volume") << QStringLiteral("archive-multivolume.part2.rar") << QStringLiteral("archive-multivolume.part1.rar") << QString()
+                                          << VolumeSet::MissingVolume << QStringLiteral("archive-multivolume.part1.rar");
+    QTest::newRow("volume without signature") << QStringLiteral("archive-multivolume.part1.rar") << QString() << QStringLiteral("archive-multivolume.part3.rar")
+                                              << VolumeSet::DamagedVolume << QStringLiteral("archive-multivolume.part3.rar");
+}
+
+void VolumeSetTest::testValidate()
+{
+    QTemporaryDir tempDir;
+    QVERIFY(tempDir.isValid());
+
+    QFETCH(QString, removed);
+    QFETCH(QString, damaged);
+    for (int i = 1; i <= 3; ++i) {
+        const QString name = QStringLiteral("archive-multivolume.part%1.rar").arg(i);
+        if (name == removed) {
+            continue;
+        }
+        if (name == damaged) {
+            QFile file(tempDir.filePath(name));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write(QByteArray(64, '\0'));
+            continue;
+        }
+        QVERIFY(QFile::copy(QFINDTESTDATA(QStringLiteral("data/") + name), tempDir.filePath(name)));
+    }
+
+    QFETCH(QString, opened);
+    VolumeSet volumeSet(tempDir.filePath(opened), rarSuffixes);
+    QVERIFY(volumeSet.isMultiVolume());
+
+    QFETCH(VolumeSet::Status, expectedStatus);
+    QCOMPARE(volumeSet.validate(), expectedStatus);
+
+    QFETCH(QString, expectedInvalidVolume);
+    if (expectedInvalidVolume.isEmpty()) {
+        QVERIFY(volumeSet.invalidVolume().isEmpty());
+        QCOMPARE(volumeSet.totalSize(), 15360 + 15360 + 437);
+    } else {
+        QCOMPARE(volumeSet.invalidVolume(), tempDir.filePath(expectedInvalidVolume));
+    }
+}
+
+#include "volumesettest.moc"
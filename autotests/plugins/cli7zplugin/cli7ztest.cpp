@@ -271,9 +271,10 @@ void Cli7zTest::testAddArgs_data()
     QTest::addColumn<int>("compressionLevel");
     QTest::addColumn<QString>("compressionMethod");
     QTest::addColumn<ulong>("volumeSize");
+    QTest::addColumn<bool>("sortByType");
     QTest::addColumn<QStringList>("expectedArgs");
 
-    QTest::newRow("unencrypted") << QStringLiteral("/tmp/foo.7z") << QString() << false << 5 << QStringLiteral("LZMA2") << 0UL
+    QTest::newRow("unencrypted") << QStringLiteral("/tmp/foo.7z") << QString() << false << 5 << QStringLiteral("LZMA2") << 0UL << false
                                  << QStringList{
                                         QStringLiteral("a"),
                                         QStringLiteral("-mx=5"),
@@ -282,10 +283,10 @@ void Cli7zTest::testAddArgs_data()
                                     };
 
     QTest::newRow("encrypted")
-        << QStringLiteral("/tmp/foo.7z") << QStringLiteral("1234") << false << 5 << QStringLiteral("LZMA2") << 0UL
+        << QStringLiteral("/tmp/foo.7z") << QStringLiteral("1234") << false << 5 << QStringLiteral("LZMA2") << 0UL << false
         << QStringList{QStringLiteral("a"), QStringLiteral("-p1234"), QStringLiteral("-mx=5"), QStringLiteral("-m0=LZMA2"), QStringLiteral("/tmp/foo.7z")};
 
-    QTest::newRow("header-encrypted") << QStringLiteral("/tmp/foo.7z") << QStringLiteral("1234") << true << 5 << QStringLiteral("LZMA2") << 0UL
+    QTest::newRow("header-encrypted") << QStringLiteral("/tmp/foo.7z") << QStringLiteral("1234") << true << 5 << QStringLiteral("LZMA2") << 0UL << false
                                       << QStringList{
                                              QStringLiteral("a"),
                                              QStringLiteral("-p1234"),
@@ -295,7 +296,7 @@ void Cli7zTest::testAddArgs_data()
                                              QStringLiteral("/tmp/foo.7z"),
                                          };
 
-    QTest::newRow("multi-volume") << QStringLiteral("/tmp/foo.7z") << QString() << false << 5 << QStringLiteral("LZMA2") << 2500UL
+    QTest::newRow("multi-volume") << QStringLiteral("/tmp/foo.7z") << QString() << false << 5 << QStringLiteral("LZMA2") << 2500UL << false
                                   << QStringList{
                                          QStringLiteral("a"),
                                          QStringLiteral("-mx=5"),
@@ -304,13 +305,22 @@ void Cli7zTest::testAddArgs_data()
                                          QStringLiteral("/tmp/foo.7z"),
                                      };
 
-    QTest::newRow("comp-method-bzip2") << QStringLiteral("/tmp/foo.7z") << QString() << false << 5 << QStringLiteral("BZip2") << 0UL
+    QTest::newRow("comp-method-bzip2") << QStringLiteral("/tmp/foo.7z") << QString() << false << 5 << QStringLiteral("BZip2") << 0UL << false
                                        << QStringList{
                                               QStringLiteral("a"),
                                               QStringLiteral("-mx=5"),
                                               QStringLiteral("-m0=BZip2"),
                                               QStringLiteral("/tmp/foo.7z"),
                                           };
+
+    QTest::newRow("sort-by-type") << QStringLiteral("/tmp/foo.7z") << QString() << false << 5 << QStringLiteral("LZMA2") << 0UL << true
+                                  << QStringList{
+                                         QStringLiteral("a"),
+                                         QStringLiteral("-mx=5"),
+                                         QStringLiteral("-m0=LZMA2"),
+                                         QStringLiteral("-mqs=on"),
+                                         QStringLiteral("/tmp/foo.7z"),
+                                     };
 }
 
 void Cli7zTest::testAddArgs()
@@ -328,8 +338,10 @@ void Cli7zTest::testAddArgs()
     QFETCH(int, compressionLevel);
     QFETCH(ulong, volumeSize);
     QFETCH(QString, compressionMethod);
+    QFETCH(bool, sortByType);
 
-    auto replacedArgs = plugin->cliProperties()->addArgs(archiveName, {}, password, encryptHeader, compressionLevel, compressionMethod, QString(), volumeSize);
+    auto replacedArgs =
+        plugin->cliProperties()->addArgs(archiveName, {}, password, encryptHeader, compressionLevel, compressionMethod, QString(), volumeSize, sortByType);
     // The -l switch is added only for the p7zip variant, we just ignore it for simplicity.
     if (replacedArgs.contains(QLatin1String("-l"))) {
         replacedArgs.removeAll(QStringLiteral("-l"));
@@ -431,6 +443,49 @@ void Cli7zTest::testExtractArgs()
     plugin->deleteLater();
 }
 
+void Cli7zTest::testListFileArgs()
+{
+    if (!m_plugin || !m_plugin->isValid()) {
+        QSKIP("cli7z plugin not available. Skipping test.", SkipSingle);
+    }
+
+    const QString archiveName = QStringLiteral("/tmp/foo.7z");
+    CliPlugin *plugin = new CliPlugin(this, {QVariant(archiveName), QVariant::fromValue(m_plugin->metaData())});
+    QVERIFY(plugin);
+
+    QVERIFY(plugin->cliProperties()->supportsListFile());
+    const QStringList fileArgs = plugin->cliProperties()->listFileArgs(QStringLiteral("/tmp/list.txt"));
+    QCOMPARE(fileArgs, (QStringList{QStringLiteral("-scsUTF-8"), QStringLiteral("@/tmp/list.txt")}));
+
+    const auto replacedArgs = plugin->cliProperties()->extractArgs(archiveName, fileArgs, true, QString());
+    QCOMPARE(replacedArgs,
+             (QStringList{QStringLiteral("x"), archiveName, QStringLiteral("-scsUTF-8"), QStringLiteral("@/tmp/list.txt")}));
+
+    plugin->deleteLater();
+}
+
+void Cli7zTest::testExtractToStdoutArgs()
+{
+    if (!m_plugin || !m_plugin->isValid()) {
+        QSKIP("cli7z plugin not available. Skipping test.", SkipSingle);
+    }
+
+    const QString archiveName = QStringLiteral("/tmp/foo.7z");
+    CliPlugin *plugin = new CliPlugin(this, {QVariant(archiveName), QVariant::fromValue(m_plugin->metaData())});
+    QVERIFY(plugin);
+
+    QVERIFY(plugin->cliProperties()->supportsExtractToStdout());
+    QVERIFY(plugin->canExtractToMemory(new Archive::Entry(this, QStringLiteral("aDir/textfile1.txt"))));
+    auto dirEntry = new Archive::Entry(this, QStringLiteral("aDir/"));
+    dirEntry->setProperty("isDirectory", true);
+    QVERIFY(!plugin->canExtractToMemory(dirEntry));
+
+    QCOMPARE(plugin->cliProperties()->extractToStdoutArgs(archiveName, QStringLiteral("aDir/textfile1.txt"), QStringLiteral("1234")),
+             (QStringList{QStringLiteral("e"), QStringLiteral("-so"), QStringLiteral("-p1234"), archiveName, QStringLiteral("aDir/textfile1.txt")}));
+
+    plugin->deleteLater();
+}
+
 void Cli7zTest::testRDAAttributes()
 {
     if (!m_plugin || !m_plugin->isValid()) {
@@ -27,6 +27,8 @@ private Q_SLOTS:
     void testAddArgs();
     void testExtractArgs_data();
     void testExtractArgs();
+    void testListFileArgs();
+    void testExtractToStdoutArgs();
     void testRDAAttributes();
 
 private:
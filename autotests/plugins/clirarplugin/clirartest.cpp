@@ -275,6 +275,40 @@ void CliRarTest::testList()
     rarPlugin->deleteLater();
 }
 
+void CliRarTest::testCanExtractInParallel_data()
+{
+    QTest::addColumn<QString>("outputTextFile");
+    QTest::addColumn<bool>("canExtractInParallel");
+
+    QTest::newRow("RARv5-unrar5") << QFINDTESTDATA("data/archive-RARv5-unrar5.txt") << true;
+    // The files spanning several volumes are listed once per volume.
+    QTest::newRow("multivolume-archive-unrar5") << QFINDTESTDATA("data/archive-multivol-unrar5.txt") << false;
+    QTest::newRow("multivolume-archive-unrar4") << QFINDTESTDATA("data/archive-multivol-unrar4.txt") << false;
+}
+
+void CliRarTest::testCanExtractInParallel()
+{
+    if (!m_plugin || !m_plugin->isValid()) {
+        QSKIP("clirar plugin not available. Skipping test.", SkipSingle);
+    }
+
+    CliPlugin *rarPlugin = new CliPlugin(this, {QStringLiteral("dummy.rar"), QVariant::fromValue(m_plugin->metaData())});
+
+    QFETCH(QString, outputTextFile);
+    QFile outputText(outputTextFile);
+    QVERIFY(outputText.open(QIODevice::ReadOnly));
+
+    QTextStream outputStream(&outputText);
+    while (!outputStream.atEnd()) {
+        QVERIFY(rarPlugin->readListLine(outputStream.readLine()));
+    }
+
+    QFETCH(bool, canExtractInParallel);
+    QCOMPARE(rarPlugin->canExtractInParallel(), canExtractInParallel);
+
+    rarPlugin->deleteLater();
+}
+
 void CliRarTest::testListArgs_data()
 {
     QTest::addColumn<QString>("archiveName");
@@ -22,6 +22,8 @@ private Q_SLOTS:
     void testArchive();
     void testList_data();
     void testList();
+    void testCanExtractInParallel_data();
+    void testCanExtractInParallel();
     void testListArgs_data();
     void testListArgs();
     void testAddArgs_data();
@@ -6,10 +6,13 @@
 
 #include "cliunarchivertest.h"
 #include "jobs.h"
+#include "lsarjsonreader.h"
 #include "testhelper.h"
 
 #include <QDirIterator>
 #include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
 #include <QSignalSpy>
 #include <QTest>
 #include <QTextStream>
@@ -163,6 +166,42 @@ void CliUnarchiverTest::testList()
     plugin->deleteLater();
 }
 
+void CliUnarchiverTest::testListInChunks_data()
+{
+    QTest::addColumn<QString>("jsonFilePath");
+    QTest::addColumn<int>("chunkSize");
+
+    QTest::newRow("one byte at a time") << QFINDTESTDATA("data/encrypted_entries.json") << 1;
+    QTest::newRow("small chunks") << QFINDTESTDATA("data/multiple_toplevel_entries.json") << 7;
+    QTest::newRow("huge archive") << QFINDTESTDATA("data/huge_archive.json") << 4096;
+}
+
+void CliUnarchiverTest::testListInChunks()
+{
+    QFETCH(QString, jsonFilePath);
+    QFETCH(int, chunkSize);
+
+    QFile jsonFile(jsonFilePath);
+    QVERIFY(jsonFile.open(QIODevice::ReadOnly));
+    const QByteArray jsonOutput = jsonFile.readAll();
+    const QJsonObject expected = QJsonDocument::fromJson(jsonOutput).object();
+
+    QJsonArray entries;
+    LsarJsonReader reader([&entries](const QJsonObject &item) {
+        entries.append(item);
+    });
+
+    for (qsizetype i = 0; i < jsonOutput.size(); i += chunkSize) {
+        QVERIFY(reader.read(QByteArrayView(jsonOutput).sliced(i, qMin<qsizetype>(chunkSize, jsonOutput.size() - i))));
+    }
+    QVERIFY(reader.isComplete());
+
+    QCOMPARE(entries, expected.value(QStringLiteral("lsarContents")).toArray());
+    QJsonObject expectedProperties = expected;
+    expectedProperties.remove(QStringLiteral("lsarContents"));
+    QCOMPARE(reader.properties(), expectedProperties);
+}
+
 void CliUnarchiverTest::testListArgs_data()
 {
     QTest::addColumn<QString>("archiveName");
@@ -240,6 +279,14 @@ void CliUnarchiverTest::testExtraction_data()
            })
         << dragAndDropOptions << 4;
 
+    QTest::newRow("extract selected entries from a rar, drag-and-drop from the top level")
+        << QFINDTESTDATA("data/one_toplevel_folder.rar")
+        << (QList<Archive::Entry *>{
+               new Archive::Entry(this, QStringLiteral("A/test2.txt")),
+               new Archive::Entry(this, QStringLiteral("A/B/C/test1.txt")),
+           })
+        << dragAndDropOptions << 5;
+
     QTest::newRow("rar with empty folders") << QFINDTESTDATA("data/empty_folders.rar") << QList<Archive::Entry *>() << defaultOptions << 5;
 
     QTest::newRow("rar with hidden folder and files") << QFINDTESTDATA("data/hidden_files.rar") << QList<Archive::Entry *>() << defaultOptions << 4;
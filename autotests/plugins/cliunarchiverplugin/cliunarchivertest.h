@@ -23,6 +23,8 @@ private Q_SLOTS:
     void testArchive();
     void testList_data();
     void testList();
+    void testListInChunks_data();
+    void testListInChunks();
     void testListArgs_data();
     void testListArgs();
     void testExtraction_data();
@@ -0,0 +1,238 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "tarrenamertest.h"
+#include "tarrenamer.h"
+
+#include <QTest>
+
+#include <archive.h>
+#include <archive_entry.h>
+
+#include <cstring>
+
+QTEST_GUILESS_MAIN(TarRenamerTest)
+
+static const QByteArray PosixMagic = QByteArrayLiteral("ustar\0" "00");
+static const QByteArray GnuMagic = QByteArrayLiteral("ustar  \0");
+
+static QByteArray padded(const QByteArray &data)
+{
+    QByteArray result = data;
+    result.resize((data.size() + 511) / 512 * 512, '\0');
+    return result;
+}
+
+static QByteArray tarHeader(const QByteArray &name, char type, qint64 size, const QByteArray &magic = PosixMagic, const QByteArray &prefix = QByteArray())
+{
+    QByteArray block(512, '\0');
+    const auto setField = [&block](int offset, const QByteArray &value) {
+        memcpy(block.data() + offset, value.constData(), value.size());
+    };
+    setField(0, name.left(100));
+    setField(100, "0000644");
+    setField(108, "0001750");
+    setField(116, "0001750");
+    setField(124, QByteArray::number(size, 8).rightJustified(11, '0'));
+    setField(136, "14000000000");
+    block[156] = type;
+    setField(257, magic);
+    setField(265, "user");
+    setField(297, "group");
+    setField(345, prefix);
+
+    setField(148, "        ");
+    int sum = 0;
+    for (char c : std::as_const(block)) {
+        sum += static_cast<uchar>(c);
+    }
+    setField(148, QByteArray::number(sum, 8).rightJustified(6, '0') + '\0' + ' ');
+    return block;
+}
+
+static QByteArray tarEntry(const QByteArray &name, const QByteArray &data, const QByteArray &magic = PosixMagic, const QByteArray &prefix = QByteArray())
+{
+    return tarHeader(name, '0', data.size(), magic, prefix) + padded(data);
+}
+
+static QByteArray paxRecord(const QByteArray &key, const QByteArray &value)
+{
+    const QByteArray record = ' ' + key + '=' + value + '\n';
+    qsizetype length = record.size() + 1;
+    while (QByteArray::number(length).size() + record.size() != length) {
+        ++length;
+    }
+    return QByteArray::number(length) + record;
+}
+
+static QByteArray paxHeader(char type, const QByteArray &records)
+{
+    return tarHeader("./PaxHeaders/entry", type, records.size()) + padded(records);
+}
+
+static QByteArray endOfArchive()
+{
+    return QByteArray(1024, '\0');
+}
+
+/**
+ * Feeds @p tar to a TarRenamer in small chunks and collects what it writes.
+ */
+static bool renameInStream(const QByteArray &tar, const QMap<QString, QString> &pathMap, QByteArray &output)
+{
+    TarRenamer renamer(pathMap, [&output](const char *data, qint64 size) {
+        output.append(data, size);
+        return true;
+    });
+    for (qsizetype pos = 0; pos < tar.size(); pos += 100) {
+        if (!renamer.write(tar.constData() + pos, std::min<qsizetype>(100, tar.size() - pos))) {
+            return false;
+        }
+    }
+    return renamer.finish();
+}
+
+/**
+ * @return The patches to rename the entries of @p tar in place, which is only possible
+ *         if every patch has the size of the headers it replaces.
+ */
+static std::vector<TarRenamer::Patch> renameInPlace(const QByteArray &tar, const QMap<QString, QString> &pathMap, bool &isSuccessful)
+{
+    TarRenamer renamer(pathMap, TarRenamer::Sink());
+    isSuccessful = renamer.write(tar.constData(), tar.size()) && renamer.finish();
+    return renamer.patches();
+}
+
+/**
+ * @return The paths and contents of the entries of @p tar, as read by libarchive.
+ */
+static QMap<QString, QByteArray> readTar(const QByteArray &tar)
+{
+    QMap<QString, QByteArray> entries;
+    struct archive *reader = archive_read_new();
+    archive_read_support_format_tar(reader);
+    if (archive_read_open_memory(reader, tar.constData(), tar.size()) == ARCHIVE_OK) {
+        struct archive_entry *entry;
+        while (archive_read_next_header(reader, &entry) == ARCHIVE_OK) {
+            QByteArray data(archive_entry_size(entry), '\0');
+            archive_read_data(reader, data.data(), data.size());
+            entries.insert(QString::fromUtf8(archive_entry_pathname_utf8(entry)), data);
+        }
+    }
+    archive_read_free(reader);
+    return entries;
+}
+
+void TarRenamerTest::testShortNameInPlace()
+{
+    const QByteArray tar = tarEntry("a.txt", "first") + tarEntry("b.txt", "second") + endOfArchive();
+
+    bool isSuccessful = false;
+    const auto patches = renameInPlace(tar, {{QStringLiteral("a.txt"), QStringLiteral("c.txt")}}, isSuccessful);
+    QVERIFY(isSuccessful);
+    QCOMPARE(patches.size(), std::size_t(1));
+    QCOMPARE(patches.front().offset, qint64(0));
+    QCOMPARE(qint64(patches.front().headers.size()), patches.front().length);
+
+    QByteArray renamed = tar;
+    renamed.replace(patches.front().offset, patches.front().length, patches.front().headers);
+    const QMap<QString, QByteArray> expected = {{QStringLiteral("c.txt"), "first"}, {QStringLiteral("b.txt"), "second"}};
+    QCOMPARE(readTar(renamed), expected);
+}
+
+void TarRenamerTest::testPrefixSplitName()
+{
+    const QByteArray tar = tarEntry("file.txt", "content", PosixMagic, "some/long/directory") + endOfArchive();
+    QCOMPARE(readTar(tar).keys(), QStringList{QStringLiteral("some/long/directory/file.txt")});
+
+    bool isSuccessful = false;
+    const auto patches = renameInPlace(tar, {{QStringLiteral("some/long/directory/file.txt"), QStringLiteral("other/file.txt")}}, isSuccessful);
+    QVERIFY(isSuccessful);
+    QCOMPARE(patches.size(), std::size_t(1));
+    QCOMPARE(qint64(patches.front().headers.size()), patches.front().length);
+
+    QByteArray renamed = tar;
+    renamed.replace(patches.front().offset, patches.front().length, patches.front().headers);
+    const QMap<QString, QByteArray> expected = {{QStringLiteral("other/file.txt"), "content"}};
+    QCOMPARE(readTar(renamed), expected);
+}
+
+void TarRenamerTest::testNameGrowingIntoPaxHeader()
+{
+    const QByteArray tar = tarEntry("a.txt", "first") + tarEntry("b.txt", "second") + endOfArchive();
+    const QString longName = QString(120, QLatin1Char('n')) + QStringLiteral(".txt");
+    const QMap<QString, QString> pathMap = {{QStringLiteral("a.txt"), longName}};
+
+    // The name needs a pax header, which doesn't fit where the old header was.
+    bool isSuccessful = false;
+    const auto patches = renameInPlace(tar, pathMap, isSuccessful);
+    QVERIFY(isSuccessful);
+    QCOMPARE(patches.size(), std::size_t(1));
+    QVERIFY(qint64(patches.front().headers.size()) > patches.front().length);
+
+    QByteArray renamed;
+    QVERIFY(renameInStream(tar, pathMap, renamed));
+    const QMap<QString, QByteArray> expected = {{longName, "first"}, {QStringLiteral("b.txt"), "second"}};
+    QCOMPARE(readTar(renamed), expected);
+}
+
+void TarRenamerTest::testGnuLongName()
+{
+    const QByteArray oldName = QByteArray(150, 'o') + ".txt";
+    const QByteArray newName = QByteArray(180, 'n') + ".txt";
+    const QByteArray longName = oldName + '\0';
+    const QByteArray tar = tarHeader("././@LongLink", 'L', longName.size(), GnuMagic) + padded(longName) + tarEntry(oldName, "content", GnuMagic)
+        + tarEntry("b.txt", "second", GnuMagic) + endOfArchive();
+    QVERIFY(readTar(tar).contains(QString::fromUtf8(oldName)));
+
+    QByteArray renamed;
+    QVERIFY(renameInStream(tar, {{QString::fromUtf8(oldName), QString::fromUtf8(newName)}}, renamed));
+    const QMap<QString, QByteArray> expected = {{QString::fromUtf8(newName), "content"}, {QStringLiteral("b.txt"), "second"}};
+    QCOMPARE(readTar(renamed), expected);
+}
+
+void TarRenamerTest::testGnuLongNameAndPaxPath()
+{
+    // Both headers carry the name, the pax one takes precedence when reading.
+    const QByteArray oldName = QByteArray(150, 'o') + ".txt";
+    const QByteArray newName = QByteArray(180, 'n') + ".txt";
+    const QByteArray longName = oldName + '\0';
+    const QByteArray tar = tarHeader("././@LongLink", 'L', longName.size(), GnuMagic) + padded(longName) + paxHeader('x', paxRecord("path", oldName))
+        + tarEntry(oldName, "content") + endOfArchive();
+    QVERIFY(readTar(tar).contains(QString::fromUtf8(oldName)));
+
+    QByteArray renamed;
+    QVERIFY(renameInStream(tar, {{QString::fromUtf8(oldName), QString::fromUtf8(newName)}}, renamed));
+    const QMap<QString, QByteArray> expected = {{QString::fromUtf8(newName), "content"}};
+    QCOMPARE(readTar(renamed), expected);
+    QVERIFY(!renamed.contains(oldName));
+}
+
+void TarRenamerTest::testGlobalHeaderPassedThrough()
+{
+    const QByteArray globalHeader = paxHeader('g', paxRecord("comment", "kept as it is"));
+    const QByteArray tar = globalHeader + tarEntry("a.txt", "first") + endOfArchive();
+
+    QByteArray renamed;
+    QVERIFY(renameInStream(tar, {{QStringLiteral("a.txt"), QStringLiteral("c.txt")}}, renamed));
+    QVERIFY(renamed.startsWith(globalHeader));
+    QCOMPARE(renamed.size(), tar.size());
+    const QMap<QString, QByteArray> expected = {{QStringLiteral("c.txt"), "first"}};
+    QCOMPARE(readTar(renamed), expected);
+}
+
+void TarRenamerTest::testInvalidChecksum()
+{
+    QByteArray tar = tarEntry("a.txt", "first") + tarEntry("b.txt", "second") + endOfArchive();
+    // Change the name of the second entry without updating its checksum.
+    tar[1024] = 'x';
+
+    TarRenamer renamer({{QStringLiteral("a.txt"), QStringLiteral("c.txt")}}, TarRenamer::Sink());
+    QVERIFY(!renamer.write(tar.constData(), tar.size()));
+    QVERIFY(!renamer.finish());
+}
+
+#include "moc_tarrenamertest.cpp"
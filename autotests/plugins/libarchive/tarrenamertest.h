@@ -0,0 +1,26 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef TARRENAMERTEST_H
+#define TARRENAMERTEST_H
+
+#include <QObject>
+
+class TarRenamerTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void testShortNameInPlace();
+    void testPrefixSplitName();
+    void testNameGrowingIntoPaxHeader();
+    void testGnuLongName();
+    void testGnuLongNameAndPaxPath();
+    void testGlobalHeaderPassedThrough();
+    void testInvalidChecksum();
+};
+
+#endif
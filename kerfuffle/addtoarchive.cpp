@@ -46,6 +46,16 @@ void AddToArchive::setChangeToFirstPath(bool value)
     m_changeToFirstPath = value;
 }
 
+void AddToArchive::setUpdateMode(bool value)
+{
+    m_options.setUpdateMode(value);
+}
+
+void AddToArchive::setFileList(const QString &listFile)
+{
+    m_options.setFileList(listFile);
+}
+
 void AddToArchive::setFilename(const QUrl &path)
 {
     m_filename = path.toLocalFile();
@@ -70,7 +80,7 @@ bool AddToArchive::showAddDialog(QWidget *parentWidget)
 {
     qCDebug(ARK_LOG) << "Opening add dialog";
 
-    if (m_filename.isEmpty()) {
+    if (m_filename.isEmpty() && !m_entries.isEmpty()) {
         m_filename = getFileNameForEntries(m_entries, QString());
     }
 
@@ -93,6 +103,7 @@ bool AddToArchive::showAddDialog(QWidget *parentWidget)
         m_options.setCompressionMethod(dialog.data()->compressionMethod());
         m_options.setEncryptionMethod(dialog.data()->encryptionMethod());
         m_options.setVolumeSize(dialog.data()->volumeSize());
+        m_options.setSortByType(dialog.data()->sortByType());
     }
 
     delete dialog.data();
@@ -128,12 +139,20 @@ bool AddToArchive::doKill()
 
 void AddToArchive::slotStartJob()
 {
-    if (m_entries.isEmpty()) {
+    const bool hasFileList = !m_options.fileList().isEmpty();
+    if (m_entries.isEmpty() && !hasFileList) {
         KMessageBox::error(nullptr, i18n("No input files were given."));
         emitResult();
         return;
     }
 
+    // The files of a list are only known while they are added.
+    if (hasFileList && m_filename.isEmpty()) {
+        KMessageBox::error(nullptr, xi18n("You need to supply a filename for the archive with the <command>--add-to</command> argument."));
+        emitResult();
+        return;
+    }
+
     if (m_filename.isEmpty()) {
         if (m_autoFilenameSuffix.isEmpty()) {
             KMessageBox::error(nullptr,
@@ -152,13 +171,14 @@ void AddToArchive::slotStartJob()
         detectFileName();
     }
 
+    // In update mode an existing archive is refreshed instead of replaced.
     QFileInfo localFileInfo(m_filename);
-    if (localFileInfo.exists() && !confirmAndDelete(m_filename)) {
+    if (localFileInfo.exists() && !m_options.isUpdateMode() && !confirmAndDelete(m_filename)) {
         qCWarning(ARK_LOG) << "Failed to start add job, file" << m_filename << "exists and not removed";
         return;
     }
 
-    if (m_changeToFirstPath) {
+    if (m_changeToFirstPath && !hasFileList) {
         if (m_firstPath.isEmpty()) {
             qCWarning(ARK_LOG) << "Weird, this should not happen. no firstpath defined. aborting";
             emitResult();
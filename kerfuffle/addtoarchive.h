@@ -39,6 +39,13 @@ public:
     bool showAddDialog(QWidget *parentWidget);
     void setPreservePaths(bool value);
     void setChangeToFirstPath(bool value);
+    void setUpdateMode(bool value);
+
+    /**
+     * Adds the files listed in @p listFile, separated by NUL characters, or in the
+     * standard input if @p listFile is "-". The list is read while the files are added.
+     */
+    void setFileList(const QString &listFile);
     void setImmediateProgressReporting(bool immediateProgressReporting);
     static QString findCommonPrefixForUrls(const QList<QUrl> &urls);
     static QString getFileNameForEntries(const QList<Archive::Entry *> &entries, const QString &suffix);
@@ -24,6 +24,7 @@ Archive::Entry::Entry(QObject *parent, const QString &fullPath, const QString &r
     , m_isExecutable(false)
     , m_isPasswordProtected(false)
     , m_isSparse(false)
+    , m_index(-1)
 {
     if (!fullPath.isEmpty())
         setFullPath(fullPath);
@@ -48,6 +49,11 @@ bool Archive::Entry::isSparse() const
     return m_isSparse;
 }
 
+qlonglong Archive::Entry::index() const
+{
+    return m_index;
+}
+
 void Archive::Entry::copyMetaData(const Archive::Entry *sourceEntry)
 {
     setProperty("fullPath", sourceEntry->property("fullPath"));
@@ -66,6 +72,7 @@ void Archive::Entry::copyMetaData(const Archive::Entry *sourceEntry)
     setProperty("timestamp", sourceEntry->property("timestamp").toDateTime());
     setProperty("isDirectory", sourceEntry->property("isDirectory"));
     setProperty("isPasswordProtected", sourceEntry->property("isPasswordProtected"));
+    setProperty("index", sourceEntry->property("index"));
 }
 
 QList<Archive::Entry *> Archive::Entry::entries()
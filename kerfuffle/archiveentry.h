@@ -55,6 +55,8 @@ class KERFUFFLE_EXPORT Archive::Entry : public QObject
     Q_PROPERTY(bool isExecutable MEMBER m_isExecutable WRITE setIsExecutable)
     Q_PROPERTY(bool isPasswordProtected MEMBER m_isPasswordProtected)
     Q_PROPERTY(bool isSparse MEMBER m_isSparse)
+    /// The position of the entry in the archive as reported by the plugin, or -1 if unknown.
+    Q_PROPERTY(qlonglong index MEMBER m_index)
 
 public:
     explicit Entry(QObject *parent = nullptr, const QString &fullPath = {}, const QString &rootNode = {});
@@ -86,6 +88,7 @@ public:
     qulonglong size() const;
     qulonglong sparseSize() const;
     bool isSparse() const;
+    qlonglong index() const;
 
     /**
      * Fills @p dirs and @p files with the number of directories and files
@@ -123,6 +126,7 @@ private:
     bool m_isExecutable;
     bool m_isPasswordProtected;
     bool m_isSparse;
+    qlonglong m_index;
     mutable QIcon m_icon;
 };
 
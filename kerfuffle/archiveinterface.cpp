@@ -287,6 +287,20 @@ QMimeType ReadOnlyArchiveInterface::mimetype() const
     return m_mimetype;
 }
 
+bool ReadOnlyArchiveInterface::canExtractToMemory(const Archive::Entry *entry) const
+{
+    Q_UNUSED(entry)
+    return false;
+}
+
+bool ReadOnlyArchiveInterface::extractToMemory(Archive::Entry *entry, const ExtractionOptions &options, qint64 maxSize)
+{
+    Q_UNUSED(entry)
+    Q_UNUSED(options)
+    Q_UNUSED(maxSize)
+    return false;
+}
+
 bool ReadOnlyArchiveInterface::hasBatchExtractionProgress() const
 {
     return false;
@@ -317,6 +331,11 @@ bool ReadWriteArchiveInterface::isReadOnly() const
     }
 }
 
+bool ReadWriteArchiveInterface::canAddFromFileList() const
+{
+    return false;
+}
+
 uint ReadOnlyArchiveInterface::numberOfEntries() const
 {
     return m_numberOfEntries;
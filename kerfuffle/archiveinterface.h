@@ -89,6 +89,19 @@ public:
      */
     virtual bool extractFiles(const QList<Archive::Entry *> &files, const QString &destinationDirectory, const ExtractionOptions &options) = 0;
 
+    /**
+     * @return Whether extractToMemory() can extract the single file @p entry.
+     */
+    virtual bool canExtractToMemory(const Archive::Entry *entry) const;
+
+    /**
+     * Extracts the contents of the single file @p entry without writing anything to disk.
+     * The contents are passed by the extractedToMemory() signal, which is emitted before finished(true).
+     * The extraction fails if the contents turn out to be larger than @p maxSize.
+     * The default implementation does not support it and returns false.
+     */
+    virtual bool extractToMemory(Archive::Entry *entry, const ExtractionOptions &options, qint64 maxSize);
+
     /**
      * @return Whether the plugins do NOT run the functions in their own thread.
      * @see setWaitForFinishedSignal()
@@ -185,6 +198,7 @@ Q_SIGNALS:
     void testSuccess();
     void compressionMethodFound(const QString &method);
     void encryptionMethodFound(const QString &method);
+    void extractedToMemory(const QByteArray &data);
 
     /**
      * Emitted when @p query needs to be executed on the GUI thread.
@@ -256,6 +270,13 @@ public:
     virtual bool deleteFiles(const QList<Archive::Entry *> &files) = 0;
     virtual bool addComment(const QString &comment) = 0;
 
+    /**
+     * @return Whether addFiles() can read the files to add from CompressionOptions::fileList()
+     * while it writes them, without getting them as entries. Otherwise AddJob reads the whole
+     * list first and passes the files to addFiles() as usual.
+     */
+    virtual bool canAddFromFileList() const;
+
 Q_SIGNALS:
     void entryRemoved(const QString &path);
 
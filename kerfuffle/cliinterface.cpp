@@ -7,12 +7,13 @@
 */
 
 #include "cliinterface.h"
+#include "archiveformat.h"
 #include "ark_debug.h"
+#include "clitoolcache.h"
 #include "queries.h"
 
-#ifdef Q_OS_WIN
 #include <KProcess>
-#else
+#ifndef Q_OS_WIN
 #include <KPtyDevice>
 #include <KPtyProcess>
 #endif
@@ -24,17 +25,32 @@
 #include <QDirIterator>
 #include <QFile>
 #include <QMimeDatabase>
-#include <QStandardPaths>
+#include <QSet>
 #include <QTemporaryDir>
 #include <QTemporaryFile>
 #include <QThread>
 #include <QUrl>
 
+#include <algorithm>
+#include <utility>
+
+#ifndef Q_OS_WIN
+#include <unistd.h>
+#endif
+
 namespace Kerfuffle
 {
 bool autoSkipFiles = false;
 bool overwriteAllFiles = false;
 
+// Below this, starting more than one process is not worth it.
+constexpr qulonglong ParallelExtractionMinimumSize = 32 * 1024 * 1024;
+constexpr int MaxExtractionWorkers = 8;
+// Stays well below the limit on the length of the arguments of a process.
+constexpr qsizetype MaxWorkerArgumentsLength = 128 * 1024;
+// Above this, paths are written to a list file if the program supports it.
+constexpr qsizetype ListFileMinimumLength = 16 * 1024;
+
 CliInterface::CliInterface(QObject *parent, const QVariantList &args)
     : ReadWriteArchiveInterface(parent, args)
 {
@@ -47,6 +63,7 @@ CliInterface::CliInterface(QObject *parent, const QVariantList &args)
 CliInterface::~CliInterface()
 {
     Q_ASSERT(!m_process);
+    Q_ASSERT(m_extractionWorkers.empty());
 }
 
 void CliInterface::setListEmptyLines(bool emptyLines)
@@ -67,7 +84,18 @@ bool CliInterface::list()
 
     // To compute progress.
     m_archiveSizeOnDisk = static_cast<qulonglong>(QFileInfo(filename()).size());
-    connect(this, &ReadOnlyArchiveInterface::entry, this, &CliInterface::onEntry);
+    m_listedFiles.clear();
+    m_listedDirs.clear();
+    m_nextEntryBlock = -1;
+    connect(this, &ReadOnlyArchiveInterface::entry, this, &CliInterface::onEntry, Qt::UniqueConnection);
+
+    m_volumeSet = VolumeSet(filename(), m_cliProps->property("multiVolumeSuffix").toStringList());
+    if (!checkVolumes()) {
+        return false;
+    }
+    if (m_volumeSet.isMultiVolume()) {
+        m_archiveSizeOnDisk = static_cast<qulonglong>(m_volumeSet.totalSize());
+    }
 
     return runProcess(m_cliProps->property("listProgram").toString(), m_cliProps->listArgs(filename(), password()));
 }
@@ -88,13 +116,17 @@ bool CliInterface::extractFiles(const QList<Archive::Entry *> &files, const QStr
         }
     }
 
+    if (!checkVolumes()) {
+        return false;
+    }
+
     QUrl destDir = QUrl(destinationDirectory);
     m_oldWorkingDirExtraction = QDir::currentPath();
     QDir::setCurrent(destDir.adjusted(QUrl::RemoveScheme).url());
 
-    const bool useTmpExtractDir = options.isDragAndDropEnabled() || options.alwaysUseTempDir();
+    m_extractViaTempDir = needsTempExtractDir(files, options);
 
-    if (useTmpExtractDir) {
+    if (m_extractViaTempDir) {
         // Create an hidden temp folder in the current directory.
         m_extractTempDir.reset(new QTemporaryDir(QStringLiteral("%1/.%2-").arg(QDir::currentPath(), QCoreApplication::applicationName())));
 
@@ -108,8 +140,118 @@ bool CliInterface::extractFiles(const QList<Archive::Entry *> &files, const QStr
         QDir::setCurrent(destDir.adjusted(QUrl::RemoveScheme).url());
     }
 
+    const QList<QStringList> parts = parallelExtractionParts(files);
+    if (!parts.isEmpty()) {
+        m_isExtractingAll = files.isEmpty();
+        return runExtractionWorkers(parts);
+    }
+
     return runProcess(m_cliProps->property("extractProgram").toString(),
-                      m_cliProps->extractArgs(filename(), extractFilesList(files), options.preservePaths(), password()));
+                      m_cliProps->extractArgs(filename(), fileArgs(extractFilesList(files)), options.preservePaths(), password()));
+}
+
+bool CliInterface::canExtractToMemory(const Archive::Entry *entry) const
+{
+    return m_cliProps->supportsExtractToStdout() && !entry->isDir();
+}
+
+bool CliInterface::extractToMemory(Archive::Entry *entry, const ExtractionOptions &options, qint64 maxSize)
+{
+    Q_ASSERT(!m_memoryExtraction);
+
+    m_operationMode = Extract;
+    m_extractionOptions = options;
+
+    if (options.encryptedArchiveHint() && password().isEmpty()) {
+        // The process cannot ask for the password, extracting to disk will do it.
+        if (m_cliProps->property("passwordSwitch").toStringList().isEmpty()) {
+            Q_EMIT finished(false);
+            return false;
+        }
+
+        qCDebug(ARK_LOG) << "Password hint enabled, querying user";
+        if (!passwordQuery()) {
+            return false;
+        }
+    }
+
+    const QString programPath = CliToolCache::findExecutable(m_cliProps->property("extractProgram").toString());
+    if (programPath.isEmpty()) {
+        Q_EMIT finished(false);
+        return false;
+    }
+
+    m_memoryExtractionData.clear();
+    m_memoryExtractionData.reserve(std::min(entry->property("size").toLongLong(), maxSize));
+    m_memoryExtractionMaxSize = maxSize;
+    m_isMemoryExtractionTooLarge = false;
+
+    // No terminal and no stdin: the tool fails instead of prompting for anything.
+    m_memoryExtraction = new KProcess(this);
+    m_memoryExtraction->setOutputChannelMode(KProcess::SeparateChannels);
+    m_memoryExtraction->setNextOpenMode(QIODevice::ReadWrite);
+    m_memoryExtraction->setProgram(programPath, m_cliProps->extractToStdoutArgs(filename(), extractFilesList({entry}).constFirst(), password()));
+#ifndef Q_OS_WIN
+    m_memoryExtraction->setChildProcessModifier([]() {
+        setsid();
+    });
+#endif
+
+    connect(m_memoryExtraction, &QProcess::readyReadStandardOutput, this, [this, path = entry->fullPath()]() {
+        if (m_isMemoryExtractionTooLarge) {
+            return;
+        }
+        m_memoryExtractionData += m_memoryExtraction->readAllStandardOutput();
+        // The size that was listed cannot be trusted.
+        if (m_memoryExtractionData.size() > m_memoryExtractionMaxSize) {
+            qCDebug(ARK_LOG) << path << "is larger than" << m_memoryExtractionMaxSize << "bytes, stopping the extraction to memory";
+            m_isMemoryExtractionTooLarge = true;
+            m_memoryExtractionData.clear();
+            m_memoryExtraction->kill();
+        }
+    });
+    connect(m_memoryExtraction, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, &CliInterface::memoryExtractionFinished);
+    connect(m_memoryExtraction, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            memoryExtractionFinished(-1, QProcess::CrashExit);
+        }
+    });
+
+    qCDebug(ARK_LOG) << "Extracting" << entry->fullPath() << "to memory";
+    m_memoryExtraction->start();
+    m_memoryExtraction->closeWriteChannel();
+
+    return true;
+}
+
+void CliInterface::memoryExtractionFinished(int exitCode, QProcess::ExitStatus exitStatus)
+{
+    if (!m_isMemoryExtractionTooLarge) {
+        m_memoryExtractionData += m_memoryExtraction->readAllStandardOutput();
+    }
+    const QByteArray errors = m_memoryExtraction->readAllStandardError();
+    m_memoryExtraction->deleteLater();
+    m_memoryExtraction = nullptr;
+
+    const QByteArray data = std::exchange(m_memoryExtractionData, QByteArray());
+    if (m_abortingOperation) {
+        return;
+    }
+
+    // The job tries again on disk, where the errors are reported properly.
+    if (m_isMemoryExtractionTooLarge || data.size() > m_memoryExtractionMaxSize) {
+        Q_EMIT finished(false);
+        return;
+    }
+    if (exitStatus != QProcess::NormalExit || exitCode != 0) {
+        qCDebug(ARK_LOG) << "Extraction to memory failed with exit code" << exitCode << errors;
+        Q_EMIT finished(false);
+        return;
+    }
+
+    Q_EMIT extractedToMemory(data);
+    Q_EMIT progress(1.0);
+    Q_EMIT finished(true);
 }
 
 bool CliInterface::addFiles(const QList<Archive::Entry *> &files,
@@ -171,13 +313,14 @@ bool CliInterface::addFiles(const QList<Archive::Entry *> &files,
 
     return runProcess(m_cliProps->property("addProgram").toString(),
                       m_cliProps->addArgs(filename(),
-                                          entryFullPaths(filesToPass, NoTrailingSlash),
+                                          fileArgs(entryFullPaths(filesToPass, NoTrailingSlash)),
                                           password(),
                                           isHeaderEncryptionEnabled(),
                                           options.compressionLevel(),
                                           options.compressionMethod(),
                                           options.encryptionMethod(),
-                                          options.volumeSize()));
+                                          options.volumeSize(),
+                                          options.sortByType()));
 }
 
 bool CliInterface::moveFiles(const QList<Archive::Entry *> &files, Archive::Entry *destination, const CompressionOptions &options)
@@ -216,7 +359,8 @@ bool CliInterface::deleteFiles(const QList<Archive::Entry *> &files)
 
     m_removedFiles = files;
 
-    return runProcess(m_cliProps->property("deleteProgram").toString(), m_cliProps->deleteArgs(filename(), files, password()));
+    return runProcess(m_cliProps->property("deleteProgram").toString(),
+                      m_cliProps->deleteArgs(filename(), fileArgs(entryFullPaths(files, NoTrailingSlash)), password()));
 }
 
 bool CliInterface::testArchive()
@@ -224,14 +368,357 @@ bool CliInterface::testArchive()
     resetParsing();
     m_operationMode = Test;
 
+    if (!checkVolumes()) {
+        return false;
+    }
+
     return runProcess(m_cliProps->property("testProgram").toString(), m_cliProps->testArgs(filename(), password()));
 }
 
+bool CliInterface::checkVolumes()
+{
+    if (!m_volumeSet.isMultiVolume()) {
+        return true;
+    }
+
+    switch (m_volumeSet.validate()) {
+    case VolumeSet::Complete:
+        // The tool reads the volumes in order, the next ones are read ahead as it opens them.
+        m_volumeSet.prefetch(0);
+        m_volumeSet.prefetch(1);
+        return true;
+    case VolumeSet::MissingVolume:
+        Q_EMIT error(xi18nc("@info", "Failed to find the archive volume <filename>%1</filename>.", m_volumeSet.invalidVolume()));
+        break;
+    case VolumeSet::DamagedVolume:
+        Q_EMIT error(xi18nc("@info", "The archive volume <filename>%1</filename> is damaged.", m_volumeSet.invalidVolume()));
+        break;
+    }
+
+    Q_EMIT finished(false);
+    return false;
+}
+
+bool CliInterface::needsPty() const
+{
+    switch (m_operationMode) {
+    case List:
+        // Header-encrypted archives can only be listed with a password, which is
+        // passed on the command line if we already have it.
+        return password().isEmpty()
+            && ArchiveFormat::fromMetadata(mimetype(), m_metaData).encryptionType() == Archive::EncryptionType::HeaderEncrypted;
+    case Test:
+        // A password prompt makes the test fail anyway, see handleLine().
+        return false;
+    case Extract: {
+        // The password was either asked before running the process or is not needed,
+        // unless the program has no switch to pass it.
+        const bool mayAskPassword = m_extractionOptions.encryptedArchiveHint()
+            && (password().isEmpty() || m_cliProps->property("passwordSwitch").toStringList().isEmpty());
+        // Nothing can be overwritten in an empty folder, e.g. a temporary one.
+        const bool mayAskOverwrite = !overwriteAllFiles && !autoSkipFiles && !isEmptyDir(QDir::current());
+        return mayAskPassword || mayAskOverwrite;
+    }
+    default:
+        return true;
+    }
+}
+
+QStringList CliInterface::fileArgs(const QStringList &paths)
+{
+    if (!m_cliProps->supportsListFile()) {
+        return paths;
+    }
+
+    qsizetype length = 0;
+    for (const QString &path : paths) {
+        if (path.contains(QLatin1Char('\n'))) {
+            return paths;
+        }
+        length += path.size() + 1;
+    }
+    if (length < ListFileMinimumLength) {
+        return paths;
+    }
+
+    auto listFile = std::make_unique<QTemporaryFile>();
+    if (!listFile->open()) {
+        qCWarning(ARK_LOG) << "Failed to create a list file, passing the paths as arguments";
+        return paths;
+    }
+
+    QByteArray data;
+    data.reserve(length);
+    for (const QString &path : paths) {
+        data += path.toUtf8();
+        data += '\n';
+    }
+    if (listFile->write(data) != data.size() || !listFile->flush()) {
+        qCWarning(ARK_LOG) << "Failed to write the list file, passing the paths as arguments";
+        return paths;
+    }
+    listFile->close();
+
+    qCDebug(ARK_LOG) << "Passing" << paths.size() << "paths through" << listFile->fileName();
+    const QStringList args = m_cliProps->listFileArgs(listFile->fileName());
+    m_listFiles.push_back(std::move(listFile));
+    return args;
+}
+
+bool CliInterface::canExtractInParallel() const
+{
+    return false;
+}
+
+void CliInterface::setNextEntryBlock(int block)
+{
+    m_nextEntryBlock = block;
+}
+
+void CliInterface::volumeOpened(const QString &volume)
+{
+    const int index = m_volumeSet.indexOf(volume);
+    if (index >= 0) {
+        m_volumeSet.prefetch(index + 1);
+    }
+}
+
+QList<QStringList> CliInterface::parallelExtractionParts(const QList<Archive::Entry *> &files) const
+{
+    // Every process would have to ask its own questions, and without the paths
+    // the files of different parts could overwrite each other.
+    if (!canExtractInParallel() || m_listedFiles.empty() || needsPty() || !m_extractionOptions.preservePaths()) {
+        return {};
+    }
+
+    std::vector<const ListedFile *> selected;
+    if (files.isEmpty()) {
+        // A file may be listed more than once, e.g. once per volume it spans.
+        QSet<QString> selectedPaths;
+        selectedPaths.reserve(m_listedFiles.size());
+        for (const ListedFile &file : m_listedFiles) {
+            if (!selectedPaths.contains(file.path)) {
+                selectedPaths.insert(file.path);
+                selected.push_back(&file);
+            }
+        }
+    } else {
+        QHash<QString, const ListedFile *> listedFiles;
+        listedFiles.reserve(m_listedFiles.size());
+        for (const ListedFile &file : m_listedFiles) {
+            listedFiles.insert(file.path, &file);
+        }
+        for (const Archive::Entry *entry : files) {
+            // The programs extract the whole contents of a folder given to them.
+            const ListedFile *file = entry->isDir() ? nullptr : listedFiles.value(entry->fullPath(NoTrailingSlash));
+            if (!file) {
+                return {};
+            }
+            selected.push_back(file);
+        }
+    }
+
+    // Files of the same block form a single group, other files a group of their own.
+    struct Group {
+        qulonglong size = 0;
+        QStringList paths;
+    };
+    std::vector<Group> groups;
+    QHash<int, size_t> groupOfBlock;
+    qulonglong totalSize = 0;
+    for (const ListedFile *file : selected) {
+        size_t index = groups.size();
+        if (file->block >= 0) {
+            index = groupOfBlock.value(file->block, groups.size());
+            groupOfBlock.insert(file->block, index);
+        }
+        if (index == groups.size()) {
+            groups.emplace_back();
+        }
+        groups[index].size += file->size;
+        groups[index].paths << escapeFileName(file->path);
+        totalSize += file->size;
+    }
+
+    const int workerCount = std::min({QThread::idealThreadCount(), MaxExtractionWorkers, static_cast<int>(groups.size())});
+    if (workerCount < 2 || totalSize < ParallelExtractionMinimumSize) {
+        return {};
+    }
+
+    // The biggest groups first, each to the part with the least data so far.
+    std::sort(groups.begin(), groups.end(), [](const Group &a, const Group &b) {
+        return a.size > b.size;
+    });
+    QList<QStringList> parts(workerCount);
+    std::vector<qulonglong> partSizes(workerCount, 0);
+    std::vector<qsizetype> partLengths(workerCount, 0);
+    for (const Group &group : groups) {
+        const auto part = std::distance(partSizes.begin(), std::min_element(partSizes.begin(), partSizes.end()));
+        parts[part] << group.paths;
+        partSizes[part] += group.size;
+        for (const QString &path : group.paths) {
+            partLengths[part] += path.size() + 1;
+        }
+        if (partLengths[part] > MaxWorkerArgumentsLength && !m_cliProps->supportsListFile()) {
+            return {};
+        }
+    }
+
+    return parts;
+}
+
+bool CliInterface::runExtractionWorkers(const QList<QStringList> &parts)
+{
+    const QString programName = m_cliProps->property("extractProgram").toString();
+    const QString programPath = CliToolCache::findExecutable(programName);
+    if (programPath.isEmpty()) {
+        Q_EMIT error(xi18nc("@info", "Failed to locate program <filename>%1</filename> on disk.", programName));
+        Q_EMIT finished(false);
+        return false;
+    }
+
+    qCDebug(ARK_LOG) << "Extracting with" << parts.size() << "processes of" << programPath << "within directory" << QDir::currentPath();
+
+    m_workerCount = parts.size();
+    m_workersExitCode = 0;
+    m_workersFailed = false;
+
+    for (const QStringList &part : parts) {
+        auto worker = new KProcess;
+        worker->setOutputChannelMode(KProcess::MergedChannels);
+        worker->setNextOpenMode(QIODevice::ReadWrite | QIODevice::Text);
+        worker->setProgram(programPath, m_cliProps->extractArgs(filename(), fileArgs(part), true, password()));
+#ifndef Q_OS_WIN
+        worker->setChildProcessModifier([]() {
+            setsid();
+        });
+#endif
+
+        connect(worker, &QProcess::readyReadStandardOutput, this, [this, worker]() {
+            readWorkerOutput(worker, false);
+        });
+        connect(worker, QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished), this, [this, worker](int exitCode) {
+            workerFinished(worker, exitCode);
+        });
+
+        m_extractionWorkers.push_back(worker);
+    }
+
+    for (KProcess *worker : m_extractionWorkers) {
+        worker->start();
+    }
+
+    return true;
+}
+
+void CliInterface::readWorkerOutput(KProcess *worker, bool handleAll)
+{
+    if (m_workersFailed) {
+        return;
+    }
+
+    QByteArray &output = m_workerOutput[worker];
+    output += worker->readAllStandardOutput();
+
+    qsizetype lineStart = 0;
+    while (lineStart < output.size()) {
+        qsizetype lineEnd = output.indexOf('\n', lineStart);
+        if (lineEnd == -1) {
+            if (!handleAll) {
+                break;
+            }
+            lineEnd = output.size();
+        }
+
+        const QByteArrayView line = QByteArrayView(output).sliced(lineStart, lineEnd - lineStart);
+        lineStart = lineEnd + 1;
+        if (!line.isEmpty() && !handleWorkerLine(QString::fromLocal8Bit(line))) {
+            m_workersFailed = true;
+            killWorkers();
+            return;
+        }
+    }
+    output.remove(0, std::min(lineStart, output.size()));
+}
+
+bool CliInterface::handleWorkerLine(const QString &line)
+{
+    if (m_cliProps->property("captureProgress").toBool() && line.indexOf(QLatin1Char('%')) > 1) {
+        // The progress is that of the processes as a whole, see workerFinished().
+        return true;
+    }
+
+    if (isDiskFullMsg(line)) {
+        qCWarning(ARK_LOG) << "Found disk full message:" << line;
+        Q_EMIT error(i18nc("@info", "Extraction failed because the disk is full."));
+        return false;
+    }
+
+    if (isWrongPasswordMsg(line)) {
+        qCWarning(ARK_LOG) << "Wrong password!";
+        setPassword(QString());
+        Q_EMIT error(i18nc("@info", "Extraction failed: Incorrect password"));
+        return false;
+    }
+
+    if (isPasswordPrompt(line) || isFileExistsMsg(line)) {
+        // Not expected, since the extraction only runs in parallel when nothing needs to be asked.
+        qCWarning(ARK_LOG) << "Unexpected prompt from an extraction process:" << line;
+        Q_EMIT error(i18nc("@info", "Extraction failed."));
+        return false;
+    }
+
+    return readExtractLine(line);
+}
+
+void CliInterface::workerFinished(KProcess *worker, int exitCode)
+{
+    qCDebug(ARK_LOG) << "Extraction process finished, exitcode:" << exitCode;
+
+    readWorkerOutput(worker, true);
+
+    m_workersExitCode = std::max(m_workersExitCode, exitCode);
+    m_extractionWorkers.erase(std::find(m_extractionWorkers.begin(), m_extractionWorkers.end(), worker));
+    m_workerOutput.remove(worker);
+    worker->deleteLater();
+
+    if (!m_extractionWorkers.empty()) {
+        if (!m_workersFailed) {
+            Q_EMIT progress(float(m_workerCount - m_extractionWorkers.size()) / m_workerCount);
+        }
+        return;
+    }
+
+    if (!m_workersFailed && m_isExtractingAll) {
+        // The processes were only given files, folders that are empty have to be created here.
+        for (const QString &dir : std::as_const(m_listedDirs)) {
+            QDir().mkpath(dir);
+        }
+    }
+
+    extractProcessFinished(m_workersExitCode, QProcess::NormalExit);
+}
+
+void CliInterface::killWorkers()
+{
+    // Their output is not read anymore, see readWorkerOutput().
+    Q_ASSERT(m_workersFailed);
+
+    // A copy, as the list changes when each process finishes.
+    const std::vector<KProcess *> workers = m_extractionWorkers;
+    for (KProcess *worker : workers) {
+        worker->kill();
+    }
+    for (KProcess *worker : workers) {
+        worker->waitForFinished(1000);
+    }
+}
+
 bool CliInterface::runProcess(const QString &programName, const QStringList &arguments)
 {
     Q_ASSERT(!m_process);
 
-    QString programPath = QStandardPaths::findExecutable(programName);
+    QString programPath = CliToolCache::findExecutable(programName);
     if (programPath.isEmpty()) {
         Q_EMIT error(xi18nc("@info", "Failed to locate program <filename>%1</filename> on disk.", programName));
         Q_EMIT finished(false);
@@ -240,15 +727,38 @@ bool CliInterface::runProcess(const QString &programName, const QStringList &arg
 
     qCDebug(ARK_LOG) << "Executing" << programPath << arguments << "within directory" << QDir::currentPath();
 
+    const bool interactive = needsPty();
+
 #ifdef Q_OS_WIN
     m_process = new KProcess;
+    m_usesPty = false;
 #else
-    m_process = new KPtyProcess;
-    m_process->setPtyChannels(KPtyProcess::StdinChannel);
+    if (interactive) {
+        auto ptyProcess = new KPtyProcess;
+        ptyProcess->setPtyChannels(KPtyProcess::StdinChannel);
+        m_process = ptyProcess;
+    } else {
+        m_process = new KProcess;
+        // Without a controlling terminal, a program that unexpectedly asks something
+        // on /dev/tty fails right away instead of waiting for an answer forever.
+        m_process->setChildProcessModifier([]() {
+            setsid();
+        });
+    }
+    m_usesPty = interactive;
 #endif
 
-    m_process->setOutputChannelMode(KProcess::MergedChannels);
-    m_process->setNextOpenMode(QIODevice::ReadWrite | QIODevice::Unbuffered | QIODevice::Text);
+    if (interactive) {
+        m_process->setOutputChannelMode(KProcess::MergedChannels);
+        m_process->setNextOpenMode(QIODevice::ReadWrite | QIODevice::Unbuffered | QIODevice::Text);
+    } else {
+        qCDebug(ARK_LOG) << "Running the process without a terminal";
+        m_process->setOutputChannelMode(KProcess::SeparateChannels);
+        m_process->setNextOpenMode(QIODevice::ReadWrite | QIODevice::Text);
+        m_readyStdErrConnection = connect(m_process, &QProcess::readyReadStandardError, this, [this]() {
+            readStderr();
+        });
+    }
     m_process->setProgram(programPath, arguments);
 
     m_readyStdOutConnection = connect(m_process, &QProcess::readyReadStandardOutput, this, [this]() {
@@ -263,6 +773,7 @@ bool CliInterface::runProcess(const QString &programName, const QStringList &arg
     }
 
     m_stdOutData.clear();
+    m_stdErrData.clear();
 
     m_process->start();
 
@@ -277,10 +788,12 @@ void CliInterface::processFinished(int exitCode, QProcess::ExitStatus exitStatus
     if (m_process) {
         // handle all the remaining data in the process
         readStdout(true);
+        readStderr(true);
 
         delete m_process;
         m_process = nullptr;
     }
+    m_listFiles.clear();
 
     // #193908 - #222392
     // Don't emit finished() if the job was killed quietly.
@@ -299,6 +812,14 @@ void CliInterface::processFinished(int exitCode, QProcess::ExitStatus exitStatus
         m_newMovedFiles.clear();
     }
 
+    if (m_operationMode == Delete || m_operationMode == Move || m_operationMode == Add) {
+        // What was listed is out of date until the archive is listed again, so that
+        // extractions are neither split between processes nor checked for conflicts with it.
+        disconnect(this, &ReadOnlyArchiveInterface::entry, this, &CliInterface::onEntry);
+        m_listedFiles.clear();
+        m_listedDirs.clear();
+    }
+
     if (m_operationMode == Add && !isMultiVolume()) {
         list();
     } else if (m_operationMode == List && isCorrupt()) {
@@ -327,10 +848,12 @@ void CliInterface::extractProcessFinished(int exitCode, QProcess::ExitStatus exi
     if (m_process) {
         // Handle all the remaining data in the process.
         readStdout(true);
+        readStderr(true);
 
         delete m_process;
         m_process = nullptr;
     }
+    m_listFiles.clear();
 
     // Don't emit finished() if the job was killed quietly.
     if (m_abortingOperation) {
@@ -354,7 +877,7 @@ void CliInterface::extractProcessFinished(int exitCode, QProcess::ExitStatus exi
             return;
         }
 
-        if (!m_extractionOptions.isDragAndDropEnabled()) {
+        if (m_extractViaTempDir && !m_extractionOptions.isDragAndDropEnabled()) {
             if (!moveToDestination(QDir::current(), QDir(m_extractDestDir), m_extractionOptions.preservePaths())) {
                 Q_EMIT error(i18ncp("@info",
                                     "Could not move the extracted file to the destination directory.",
@@ -369,7 +892,7 @@ void CliInterface::extractProcessFinished(int exitCode, QProcess::ExitStatus exi
         }
     }
 
-    if (m_extractionOptions.isDragAndDropEnabled()) {
+    if (m_extractViaTempDir && m_extractionOptions.isDragAndDropEnabled()) {
         const bool droppedFilesMoved = moveDroppedFilesToDest(m_extractedFiles, m_extractDestDir);
         if (!droppedFilesMoved) {
             cleanUpExtracting();
@@ -489,7 +1012,7 @@ bool CliInterface::moveDroppedFilesToDest(const QList<Archive::Entry *> &files,
     return true;
 }
 
-bool CliInterface::isEmptyDir(const QDir &dir)
+bool CliInterface::isEmptyDir(const QDir &dir) const
 {
     QDir d = dir;
     d.setFilter(QDir::AllEntries | QDir::NoDotAndDotDot);
@@ -497,6 +1020,101 @@ bool CliInterface::isEmptyDir(const QDir &dir)
     return d.count() == 0;
 }
 
+bool CliInterface::needsTempExtractDir(const QList<Archive::Entry *> &files, const ExtractionOptions &options) const
+{
+    if (!options.isDragAndDropEnabled() && !options.alwaysUseTempDir()) {
+        return false;
+    }
+
+    // The tools cannot strip the parent folder of the dropped entries.
+    if (options.isDragAndDropEnabled()) {
+        if (!options.preservePaths()) {
+            return true;
+        }
+        const bool hasRootNode = std::any_of(files.cbegin(), files.cend(), [](const Archive::Entry *file) {
+            return !file->rootNode.isEmpty();
+        });
+        if (hasRootNode) {
+            return true;
+        }
+    }
+
+    // Tools that need a temporary dir cannot be trusted with wrong passwords nor to drop the paths.
+    if (options.alwaysUseTempDir() && (!options.preservePaths() || options.encryptedArchiveHint() || !password().isEmpty())) {
+        return true;
+    }
+
+    // Existing files are still handled by moveToDestination() and moveDroppedFilesToDest().
+    return hasExtractionConflicts(files);
+}
+
+bool CliInterface::hasExtractionConflicts(const QList<Archive::Entry *> &files) const
+{
+    if (m_listedFiles.empty() && m_listedDirs.isEmpty()) {
+        return true;
+    }
+
+    const QDir destDir = QDir::current();
+    if (isEmptyDir(destDir)) {
+        return false;
+    }
+
+    QSet<QString> selectedPaths;
+    selectedPaths.reserve(files.size());
+    for (const Archive::Entry *file : files) {
+        selectedPaths.insert(file->fullPath(NoTrailingSlash));
+    }
+
+    // A path is extracted if it or one of its parent folders is selected.
+    const auto isSelected = [&selectedPaths](const QString &path) {
+        if (selectedPaths.isEmpty()) {
+            return true;
+        }
+        for (qsizetype end = path.size(); end > 0; end = path.lastIndexOf(QLatin1Char('/'), end - 1)) {
+            if (selectedPaths.contains(QStringView(path).left(end).toString())) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Nothing below a top-level entry that is not in the destination can exist.
+    QHash<QString, bool> topLevelExists;
+    const auto existingInfo = [&destDir, &topLevelExists](const QString &path) {
+        const QString topLevel = path.section(QLatin1Char('/'), 0, 0);
+        auto it = topLevelExists.find(topLevel);
+        if (it == topLevelExists.end()) {
+            const QFileInfo info(destDir.filePath(topLevel));
+            it = topLevelExists.insert(topLevel, info.exists() || info.isSymLink());
+        }
+        return it.value() ? QFileInfo(destDir.filePath(path)) : QFileInfo();
+    };
+
+    for (const ListedFile &file : m_listedFiles) {
+        if (!isSelected(file.path)) {
+            continue;
+        }
+        const QFileInfo info = existingInfo(file.path);
+        if (info.exists() || info.isSymLink()) {
+            qCDebug(ARK_LOG) << "Extraction would replace" << info.filePath();
+            return true;
+        }
+    }
+
+    for (const QString &dir : m_listedDirs) {
+        if (!isSelected(dir)) {
+            continue;
+        }
+        const QFileInfo info = existingInfo(dir);
+        if ((info.exists() && !info.isDir()) || info.isSymLink()) {
+            qCDebug(ARK_LOG) << "Extraction would replace" << info.filePath();
+            return true;
+        }
+    }
+
+    return false;
+}
+
 void CliInterface::cleanUpExtracting()
 {
     restoreWorkingDirExtraction();
@@ -668,6 +1286,7 @@ void CliInterface::killProcess(bool emitFinished)
     // waitForFinished() will enter QT's event loop. Disconnect the readyReadStandardOutput
     // signal, to avoid an endless recursion, if the process keeps spamming output on stdout.
     disconnect(m_readyStdOutConnection);
+    disconnect(m_readyStdErrConnection);
 
     m_abortingOperation = !emitFinished;
 
@@ -727,32 +1346,53 @@ void CliInterface::readStdout(bool handleAll)
         return;
     }
 
-    QByteArray dd = m_process->readAllStandardOutput();
-    m_stdOutData += dd;
+    if (m_stdOutData.isEmpty()) {
+        // Avoids copying the chunk when the previous one ended with a newline.
+        m_stdOutData = m_process->readAllStandardOutput();
+    } else {
+        m_stdOutData += m_process->readAllStandardOutput();
+    }
+    handleOutput(m_stdOutData, handleAll);
+}
+
+void CliInterface::readStderr(bool handleAll)
+{
+    if (m_abortingOperation || !m_process || m_usesPty) {
+        return;
+    }
+
+    // Error messages and prompts may be printed on stderr, so its lines are handled
+    // like those of stdout, as they were when both channels were merged.
+    m_stdErrData += m_process->readAllStandardError();
+    handleOutput(m_stdErrData, handleAll);
+}
 
-    QList<QByteArray> lines = m_stdOutData.split('\n');
+void CliInterface::handleOutput(QByteArray &output, bool handleAll)
+{
+    if (output.isEmpty()) {
+        return;
+    }
+
+    // Only the complete lines are looked for, the buffer is not split.
+    const qsizetype lastNewLine = output.lastIndexOf('\n');
 
     // The reason for this check is that archivers often do not end
     // queries (such as file exists, wrong password) on a new line, but
     // freeze waiting for input. So we check for errors on the last line in
     // all cases.
-    // TODO: QLatin1String() might not be the best choice here.
-    //       The call to handleLine() at the end of the method uses
-    //       QString::fromLocal8Bit(), for example.
-    // TODO: The same check methods are called in handleLine(), this
-    //       is suboptimal.
-
-    bool wrongPasswordMessage = isWrongPasswordMsg(QLatin1String(lines.last()));
-
-    bool foundErrorMessage = (wrongPasswordMessage || isDiskFullMsg(QLatin1String(lines.last())) || isFileExistsMsg(QLatin1String(lines.last())))
-        || isPasswordPrompt(QLatin1String(lines.last()));
-
-    if (foundErrorMessage) {
-        handleAll = true;
-    }
+    const QByteArrayView partialLine = QByteArrayView(output).sliced(lastNewLine + 1);
+    if (!partialLine.isEmpty()) {
+        // Decoded once, and the same way as the lines passed to handleLine().
+        const QString line = QString::fromLocal8Bit(partialLine);
+        const bool wrongPasswordMessage = isWrongPasswordMsg(line);
+
+        if (wrongPasswordMessage || isDiskFullMsg(line) || isFileExistsMsg(line) || isPasswordPrompt(line)) {
+            handleAll = true;
+        }
 
-    if (wrongPasswordMessage) {
-        setPassword(QString());
+        if (wrongPasswordMessage) {
+            setPassword(QString());
+        }
     }
 
     // this is complex, here's an explanation:
@@ -760,26 +1400,39 @@ void CliInterface::readStdout(bool handleAll)
     // handle in the output. The exception is that it is supposed to handle
     // all the data, OR if there's been an error message found in the
     // partial data.
-    if (lines.size() == 1 && !handleAll) {
+    if (lastNewLine == -1 && !handleAll) {
         return;
     }
 
+    // The lines are taken out of the buffer before being handled, as handleLine()
+    // may run an event loop (e.g. for a query) in which more output is read.
+    const QByteArray data = std::move(output);
+    qsizetype end = data.size();
     if (handleAll) {
-        m_stdOutData.clear();
+        output = QByteArray();
     } else {
         // because the last line might be incomplete we leave it for now
         // note, this last line may be an empty string if the stdoutdata ends
         // with a newline
-        m_stdOutData = lines.takeLast();
+        output = data.sliced(lastNewLine + 1);
+        end = lastNewLine;
     }
 
-    for (const QByteArray &line : std::as_const(lines)) {
+    qsizetype lineStart = 0;
+    while (lineStart <= end) {
+        qsizetype lineEnd = data.indexOf('\n', lineStart);
+        if (lineEnd == -1 || lineEnd > end) {
+            lineEnd = end;
+        }
+
+        const QByteArrayView line = QByteArrayView(data).sliced(lineStart, lineEnd - lineStart);
         if (!line.isEmpty() || (m_listEmptyLines && m_operationMode == List)) {
             if (!handleLine(QString::fromLocal8Bit(line))) {
                 killProcess();
                 return;
             }
         }
+        lineStart = lineEnd + 1;
     }
 }
 
@@ -998,6 +1651,22 @@ bool CliInterface::doKill()
         return true;
     }
 
+    if (m_memoryExtraction) {
+        m_abortingOperation = true;
+        m_memoryExtraction->kill();
+        m_memoryExtraction->waitForFinished(1000);
+        m_abortingOperation = false;
+        return true;
+    }
+
+    if (!m_extractionWorkers.empty()) {
+        m_workersFailed = true;
+        m_abortingOperation = true;
+        killWorkers();
+        m_abortingOperation = false;
+        return true;
+    }
+
     return false;
 }
 
@@ -1026,11 +1695,13 @@ void CliInterface::writeToProcess(const QByteArray &data)
 
     qCDebug(ARK_LOG) << "Writing" << data << "to the process";
 
-#ifdef Q_OS_WIN
-    m_process->write(data);
-#else
-    m_process->pty()->write(data);
+#ifndef Q_OS_WIN
+    if (m_usesPty) {
+        static_cast<KPtyProcess *>(m_process)->pty()->write(data);
+        return;
+    }
 #endif
+    m_process->write(data);
 }
 
 bool CliInterface::addComment(const QString &comment)
@@ -1079,6 +1750,13 @@ CliProperties *CliInterface::cliProperties() const
 
 void CliInterface::onEntry(Archive::Entry *archiveEntry)
 {
+    if (archiveEntry->isDir()) {
+        m_listedDirs << archiveEntry->fullPath(NoTrailingSlash);
+    } else {
+        m_listedFiles.push_back({archiveEntry->fullPath(NoTrailingSlash), archiveEntry->property("size").toULongLong(), m_nextEntryBlock});
+    }
+    m_nextEntryBlock = -1;
+
     if (archiveEntry->compressedSizeIsSet) {
         m_listedSize += archiveEntry->property("compressedSize").toULongLong();
         if (m_listedSize <= m_archiveSizeOnDisk) {
@@ -12,10 +12,14 @@
 #include "archiveinterface.h"
 #include "cliproperties.h"
 #include "kerfuffle_export.h"
+#include "volumeset.h"
 
 #include <QProcess>
 #include <QRegularExpression>
 
+#include <memory>
+#include <vector>
+
 class KProcess;
 class KPtyProcess;
 
@@ -37,6 +41,8 @@ public:
 
     bool list() override;
     bool extractFiles(const QList<Archive::Entry *> &files, const QString &destinationDirectory, const ExtractionOptions &options) override;
+    bool canExtractToMemory(const Archive::Entry *entry) const override;
+    bool extractToMemory(Archive::Entry *entry, const ExtractionOptions &options, qint64 maxSize) override;
     bool addFiles(const QList<Archive::Entry *> &files,
                   const Archive::Entry *destination,
                   const CompressionOptions &options,
@@ -87,6 +93,15 @@ public:
 
     CliProperties *cliProperties() const;
 
+    /**
+     * @return Whether the archive can be extracted by several processes at once, each of
+     *         them extracting a part of the entries. This is only worth it if the entries
+     *         (or groups of them, see setNextEntryBlock()) are compressed independently.
+     *
+     * The default implementation returns false.
+     */
+    virtual bool canExtractInParallel() const;
+
 protected:
     bool setAddedFiles();
 
@@ -119,6 +134,36 @@ protected:
      */
     bool passwordQuery();
 
+    /**
+     * @return Whether the process about to be run for the current operation may ask
+     *         a question (e.g. a password or whether to overwrite a file), which
+     *         some programs only do on a terminal.
+     *
+     * Otherwise the process is run through plain pipes, which is a lot faster for
+     * programs with a large output (e.g. listing big archives), and its standard
+     * error is read separately from its standard output.
+     */
+    virtual bool needsPty() const;
+
+    /**
+     * Sets the solid block of the next entry that is emitted while listing.
+     * Entries of the same block are always extracted by the same process.
+     * Entries emitted without a block can be extracted by any process.
+     */
+    void setNextEntryBlock(int block);
+
+    /**
+     * To be called when the process starts reading @p volume of a multi-volume archive,
+     * so that the next one is read ahead.
+     */
+    void volumeOpened(const QString &volume);
+
+    /**
+     * Handles what the process printed on its standard error, which is read
+     * separately unless the process runs on a terminal.
+     */
+    void readStderr(bool handleAll = false);
+
     void cleanUp();
 
     CliProperties *m_cliProps = nullptr;
@@ -132,11 +177,8 @@ protected:
     Archive::Entry *m_passedDestination = nullptr;
     CompressionOptions m_passedOptions;
 
-#ifdef Q_OS_WIN
+    // A KPtyProcess if needsPty() returned true, a plain KProcess otherwise.
     KProcess *m_process = nullptr;
-#else
-    KPtyProcess *m_process = nullptr;
-#endif
 
     bool m_abortingOperation = false;
 
@@ -158,7 +200,7 @@ private:
 
     /**
      * Wrapper around KProcess::write() or KPtyDevice::write(), depending on
-     * the platform.
+     * whether the process runs on a terminal.
      */
     void writeToProcess(const QByteArray &data);
 
@@ -171,7 +213,20 @@ private:
     /**
      * @return Whether @p dir is an empty directory.
      */
-    bool isEmptyDir(const QDir &dir);
+    bool isEmptyDir(const QDir &dir) const;
+
+    /**
+     * @return Whether @p files have to be extracted to a temporary directory and moved to the
+     *         current directory afterwards, rather than extracted to it directly.
+     */
+    bool needsTempExtractDir(const QList<Archive::Entry *> &files, const ExtractionOptions &options) const;
+
+    /**
+     * Looks for files in the current directory that extracting @p files with their paths would replace,
+     * based on what was listed.
+     * @return True if there are some, or if it cannot be told.
+     */
+    bool hasExtractionConflicts(const QList<Archive::Entry *> &files) const;
 
     /**
      * Performs any additional escaping and processing on @p fileName
@@ -188,7 +243,68 @@ private:
 
     void finishCopying(bool result);
 
+    /**
+     * @return The arguments to pass @p paths to the program: @p paths themselves, or the
+     *         switch to read them from a temporary list file if there are many of them
+     *         and the program supports it. The list files are removed once the process is done.
+     */
+    QStringList fileArgs(const QStringList &paths);
+
+    /**
+     * Splits the entries to extract into parts to be extracted by different processes.
+     * @return The escaped paths of each part, or an empty list if the extraction should
+     *         be done by a single process.
+     */
+    QList<QStringList> parallelExtractionParts(const QList<Archive::Entry *> &files) const;
+    bool runExtractionWorkers(const QList<QStringList> &parts);
+    void readWorkerOutput(KProcess *worker, bool handleAll);
+    bool handleWorkerLine(const QString &line);
+    void workerFinished(KProcess *worker, int exitCode);
+    void killWorkers();
+
+    void memoryExtractionFinished(int exitCode, QProcess::ExitStatus exitStatus);
+
+    /**
+     * Checks that the volumes of a multi-volume archive are all there and starts reading
+     * the first ones. Emits error() and finished() if they are not.
+     */
+    bool checkVolumes();
+
+    /**
+     * Passes the complete lines of @p output to handleLine() and keeps the
+     * last partial one, unless @p handleAll is true or it is a prompt.
+     */
+    void handleOutput(QByteArray &output, bool handleAll);
+
     QByteArray m_stdOutData;
+    QByteArray m_stdErrData;
+    std::vector<std::unique_ptr<QTemporaryFile>> m_listFiles;
+    bool m_usesPty = false;
+
+    // What was listed, to split the extraction of the whole archive between several processes.
+    struct ListedFile {
+        QString path;
+        qulonglong size;
+        int block;
+    };
+    std::vector<ListedFile> m_listedFiles;
+    QStringList m_listedDirs;
+    int m_nextEntryBlock = -1;
+
+    VolumeSet m_volumeSet;
+
+    std::vector<KProcess *> m_extractionWorkers;
+    QHash<KProcess *, QByteArray> m_workerOutput;
+    int m_workerCount = 0;
+    int m_workersExitCode = 0;
+    bool m_workersFailed = false;
+    bool m_isExtractingAll = false;
+
+    // Writes the contents of a single file to its stdout, see extractToMemory().
+    KProcess *m_memoryExtraction = nullptr;
+    QByteArray m_memoryExtractionData;
+    qint64 m_memoryExtractionMaxSize = 0;
+    bool m_isMemoryExtractionTooLarge = false;
     QRegularExpression m_passwordPromptPattern;
     QHash<int, QList<QRegularExpression>> m_patternCache;
 
@@ -201,12 +317,14 @@ private:
     ExtractionOptions m_extractionOptions;
     QString m_extractDestDir;
     QScopedPointer<QTemporaryDir> m_extractTempDir;
+    bool m_extractViaTempDir = false;
     QScopedPointer<QTemporaryFile> m_commentTempFile;
     QList<Archive::Entry *> m_extractedFiles;
     qulonglong m_archiveSizeOnDisk = 0;
     qulonglong m_listedSize = 0;
 
     QMetaObject::Connection m_readyStdOutConnection;
+    QMetaObject::Connection m_readyStdErrConnection;
 
 protected Q_SLOTS:
     virtual void processFinished(int exitCode, QProcess::ExitStatus exitStatus);
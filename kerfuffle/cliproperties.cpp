@@ -25,7 +25,8 @@ QStringList CliProperties::addArgs(const QString &archive,
                                    int compressionLevel,
                                    const QString &compressionMethod,
                                    const QString &encryptionMethod,
-                                   ulong volumeSize)
+                                   ulong volumeSize,
+                                   bool sortByType)
 {
     if (!encryptionMethod.isEmpty()) {
         Q_ASSERT(!password.isEmpty());
@@ -50,6 +51,9 @@ QStringList CliProperties::addArgs(const QString &archive,
     if (volumeSize > 0) {
         args << substituteMultiVolumeSwitch(volumeSize);
     }
+    if (sortByType) {
+        args << m_sortByTypeSwitch;
+    }
     args << archive;
     args << files;
 
@@ -70,7 +74,7 @@ QStringList CliProperties::commentArgs(const QString &archive, const QString &co
     return args;
 }
 
-QStringList CliProperties::deleteArgs(const QString &archive, const QList<Archive::Entry *> &files, const QString &password)
+QStringList CliProperties::deleteArgs(const QString &archive, const QStringList &files, const QString &password)
 {
     QStringList args;
     args << m_deleteSwitch;
@@ -78,9 +82,7 @@ QStringList CliProperties::deleteArgs(const QString &archive, const QList<Archiv
         args << substitutePasswordSwitch(password);
     }
     args << archive;
-    for (const Archive::Entry *e : files) {
-        args << e->fullPath(NoTrailingSlash);
-    }
+    args << files;
 
     args.removeAll(QString());
     return args;
@@ -106,6 +108,21 @@ QStringList CliProperties::extractArgs(const QString &archive, const QStringList
     return args;
 }
 
+QStringList CliProperties::extractToStdoutArgs(const QString &archive, const QString &file, const QString &password)
+{
+    Q_ASSERT(supportsExtractToStdout());
+
+    QStringList args = m_extractToStdoutSwitch;
+    if (!password.isEmpty()) {
+        args << substitutePasswordSwitch(password);
+    }
+    args << archive;
+    args << file;
+
+    args.removeAll(QString());
+    return args;
+}
+
 QStringList CliProperties::listArgs(const QString &archive, const QString &password)
 {
     QStringList args;
@@ -282,14 +299,43 @@ QString CliProperties::substituteMultiVolumeSwitch(ulong volumeSize) const
     return multiVolumeSwitch;
 }
 
+bool CliProperties::supportsExtractToStdout() const
+{
+    return !m_extractToStdoutSwitch.isEmpty();
+}
+
+bool CliProperties::supportsListFile() const
+{
+    return !m_listFileSwitch.isEmpty();
+}
+
+QStringList CliProperties::listFileArgs(const QString &listFile) const
+{
+    Q_ASSERT(supportsListFile());
+
+    QStringList args = m_listFileSwitch;
+    args.replaceInStrings(QLatin1String("$ListFile"), listFile);
+    return args;
+}
+
 bool CliProperties::isTestPassedMsg(const QString &line)
 {
-    for (const QString &rx : std::as_const(m_testPassedPatterns)) {
-        if (QRegularExpression(rx).match(line).hasMatch()) {
-            return true;
+    if (m_testPassedPatterns.isEmpty()) {
+        return false;
+    }
+
+    // This is called for every line printed while testing, so the patterns
+    // are matched with a single expression instead of one per pattern.
+    if (m_testPassedRegExp.pattern().isEmpty()) {
+        QStringList patterns;
+        for (const QString &rx : std::as_const(m_testPassedPatterns)) {
+            patterns << QLatin1String("(?:") + rx + QLatin1Char(')');
         }
+        m_testPassedRegExp.setPattern(patterns.join(QLatin1Char('|')));
+        m_testPassedRegExp.optimize();
     }
-    return false;
+
+    return m_testPassedRegExp.match(line).hasMatch();
 }
 
 }
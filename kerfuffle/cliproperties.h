@@ -9,6 +9,8 @@
 #include "archiveinterface.h"
 #include "kerfuffle_export.h"
 
+#include <QRegularExpression>
+
 namespace Kerfuffle
 {
 class KERFUFFLE_EXPORT CliProperties : public QObject
@@ -27,6 +29,8 @@ class KERFUFFLE_EXPORT CliProperties : public QObject
     Q_PROPERTY(QString deleteSwitch MEMBER m_deleteSwitch)
     Q_PROPERTY(QStringList extractSwitch MEMBER m_extractSwitch)
     Q_PROPERTY(QStringList extractSwitchNoPreserve MEMBER m_extractSwitchNoPreserve)
+    // Writes the contents of a single file to stdout, and nothing else.
+    Q_PROPERTY(QStringList extractToStdoutSwitch MEMBER m_extractToStdoutSwitch)
     Q_PROPERTY(QStringList listSwitch MEMBER m_listSwitch)
     Q_PROPERTY(QString moveSwitch MEMBER m_moveSwitch)
     Q_PROPERTY(QStringList testSwitch MEMBER m_testSwitch)
@@ -37,6 +41,9 @@ class KERFUFFLE_EXPORT CliProperties : public QObject
     Q_PROPERTY(QHash<QString, QVariant> compressionMethodSwitch MEMBER m_compressionMethodSwitch)
     Q_PROPERTY(QHash<QString, QVariant> encryptionMethodSwitch MEMBER m_encryptionMethodSwitch)
     Q_PROPERTY(QString multiVolumeSwitch MEMBER m_multiVolumeSwitch)
+    Q_PROPERTY(QStringList sortByTypeSwitch MEMBER m_sortByTypeSwitch)
+    // Passes the paths listed in a file, one per line in UTF-8, instead of as arguments.
+    Q_PROPERTY(QStringList listFileSwitch MEMBER m_listFileSwitch)
 
     Q_PROPERTY(QStringList testPassedPatterns MEMBER m_testPassedPatterns)
     Q_PROPERTY(QStringList fileExistsFileNameRegExp MEMBER m_fileExistsFileNameRegExp)
@@ -56,16 +63,25 @@ public:
                         int compressionLevel,
                         const QString &compressionMethod,
                         const QString &encryptionMethod,
-                        ulong volumeSize);
+                        ulong volumeSize,
+                        bool sortByType = false);
     QStringList commentArgs(const QString &archive, const QString &commentfile);
-    QStringList deleteArgs(const QString &archive, const QList<Archive::Entry *> &files, const QString &password);
+    QStringList deleteArgs(const QString &archive, const QStringList &files, const QString &password);
     QStringList extractArgs(const QString &archive, const QStringList &files, bool preservePaths, const QString &password);
+    QStringList extractToStdoutArgs(const QString &archive, const QString &file, const QString &password);
     QStringList listArgs(const QString &archive, const QString &password);
     QStringList moveArgs(const QString &archive, const QList<Archive::Entry *> &entries, Archive::Entry *destination, const QString &password);
     QStringList testArgs(const QString &archive, const QString &password);
 
     bool isTestPassedMsg(const QString &line);
 
+    bool supportsExtractToStdout() const;
+    bool supportsListFile() const;
+    /**
+     * @return The arguments to use instead of the paths written to @p listFile.
+     */
+    QStringList listFileArgs(const QString &listFile) const;
+
 private:
     QStringList substituteCommentSwitch(const QString &commentfile) const;
     QStringList substitutePasswordSwitch(const QString &password, bool headerEnc = false) const;
@@ -86,6 +102,7 @@ private:
     QString m_deleteSwitch;
     QStringList m_extractSwitch;
     QStringList m_extractSwitchNoPreserve;
+    QStringList m_extractToStdoutSwitch;
     QStringList m_listSwitch;
     QString m_moveSwitch;
     QStringList m_testSwitch;
@@ -96,8 +113,12 @@ private:
     QHash<QString, QVariant> m_compressionMethodSwitch;
     QHash<QString, QVariant> m_encryptionMethodSwitch;
     QString m_multiVolumeSwitch;
+    QStringList m_sortByTypeSwitch;
+    QStringList m_listFileSwitch;
 
     QStringList m_testPassedPatterns;
+    // All of m_testPassedPatterns in one expression, compiled on first use.
+    QRegularExpression m_testPassedRegExp;
     QStringList m_fileExistsFileNameRegExp;
 
     QStringList m_fileExistsInput;
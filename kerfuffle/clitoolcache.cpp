@@ -0,0 +1,103 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "clitoolcache.h"
+#include "ark_debug.h"
+
+#include <KConfig>
+#include <KConfigGroup>
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QProcess>
+#include <QStandardPaths>
+
+namespace Kerfuffle
+{
+namespace
+{
+QMutex s_mutex;
+QHash<QString, QString> s_executables;
+// Keyed by the executable path, its modification time and the arguments.
+QHash<QString, QString> s_probes;
+
+KConfig &probeCache()
+{
+    static KConfig config(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation) + QLatin1String("/ark/clitools"), KConfig::SimpleConfig);
+    return config;
+}
+}
+
+QString CliToolCache::findExecutable(const QString &programName)
+{
+    QMutexLocker locker(&s_mutex);
+
+    const QString cachedPath = s_executables.value(programName);
+    if (!cachedPath.isEmpty() && QFileInfo(cachedPath).isExecutable()) {
+        return cachedPath;
+    }
+
+    // Programs that are missing are looked up again, they may have been installed meanwhile.
+    const QString path = QStandardPaths::findExecutable(programName);
+    if (path.isEmpty()) {
+        s_executables.remove(programName);
+    } else {
+        s_executables.insert(programName, path);
+    }
+    return path;
+}
+
+QString CliToolCache::probe(const QString &programName, const QStringList &arguments, const std::function<QString(const QByteArray &output)> &detect, int timeout)
+{
+    const QString path = findExecutable(programName);
+    if (path.isEmpty()) {
+        return QString();
+    }
+
+    const QFileInfo info(path);
+    const QString key = QStringLiteral("%1 %2 %3").arg(info.canonicalFilePath(),
+                                                       QString::number(info.lastModified().toMSecsSinceEpoch()),
+                                                       arguments.join(QLatin1Char(' ')));
+
+    QMutexLocker locker(&s_mutex);
+
+    const auto it = s_probes.constFind(key);
+    if (it != s_probes.constEnd()) {
+        return it.value();
+    }
+
+    KConfigGroup group = probeCache().group(key);
+    if (group.hasKey("Result")) {
+        const QString result = group.readEntry("Result", QString());
+        s_probes.insert(key, result);
+        return result;
+    }
+
+    qCDebug(ARK_LOG) << "Probing" << path << arguments;
+    QProcess process;
+    process.start(path, arguments);
+    const bool isFinished = process.waitForFinished(timeout);
+    const QString result = detect(process.readAllStandardOutput());
+    if (!isFinished) {
+        process.kill();
+        process.waitForFinished();
+    }
+
+    // A program that was slow to start or crashed may have been cut short, it is probed again next time.
+    if (!isFinished || process.exitStatus() != QProcess::NormalExit) {
+        qCDebug(ARK_LOG) << "Probing" << path << "did not complete, not caching the result";
+        return result;
+    }
+
+    s_probes.insert(key, result);
+    group.writeEntry("Result", result);
+    probeCache().sync();
+    return result;
+}
+}
@@ -0,0 +1,49 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef CLITOOLCACHE_H
+#define CLITOOLCACHE_H
+
+#include "kerfuffle_export.h"
+
+#include <QByteArray>
+#include <QStringList>
+
+#include <functional>
+
+namespace Kerfuffle
+{
+/**
+ * Process-wide cache of what is known about the programs run by the CLI plugins,
+ * so that they are neither looked up in PATH nor run to probe them over and over.
+ */
+class KERFUFFLE_EXPORT CliToolCache
+{
+public:
+    /**
+     * Same as QStandardPaths::findExecutable(), except that the path found is
+     * remembered for as long as it stays executable.
+     */
+    static QString findExecutable(const QString &programName);
+
+    /**
+     * Runs @p programName with @p arguments and passes its standard output to @p detect,
+     * e.g. to tell which variant of the program is installed.
+     *
+     * @return What @p detect returned, or an empty string if the program could not be found.
+     *
+     * The result of a complete run is cached in memory and on disk for the executable at its
+     * current path and with its current modification time, so the program is only run again
+     * once it has been replaced (e.g. updated to another version). @p detect must therefore
+     * always return the same for the same program and arguments.
+     * Running the program blocks for at most @p timeout milliseconds, a run that takes longer
+     * is detected from the output so far and not cached.
+     */
+    static QString probe(const QString &programName, const QStringList &arguments, const std::function<QString(const QByteArray &output)> &detect, int timeout = 500);
+};
+}
+
+#endif // CLITOOLCACHE_H
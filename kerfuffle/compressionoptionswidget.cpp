@@ -34,6 +34,8 @@ CompressionOptionsWidget::CompressionOptionsWidget(QWidget *parent, const Compre
     connect(compMethodComboBox, &QComboBox::currentTextChanged, this, &CompressionOptionsWidget::slotCompMethodChanged);
     connect(encMethodComboBox, &QComboBox::currentTextChanged, this, &CompressionOptionsWidget::slotEncryptionMethodChanged);
 
+    sortByTypeCheckBox->setChecked(m_opts.sortByType());
+
     if (m_opts.isVolumeSizeSet()) {
         multiVolumeCheckbox->setChecked(true);
         // Convert from kilobytes.
@@ -53,6 +55,7 @@ CompressionOptions CompressionOptionsWidget::commpressionOptions() const
     if (!compMethodComboBox->currentText().isEmpty()) {
         opts.setCompressionMethod(compMethodComboBox->currentText());
     }
+    opts.setSortByType(sortByType());
 
     return opts;
 }
@@ -81,6 +84,11 @@ ulong CompressionOptionsWidget::volumeSize() const
     }
 }
 
+bool CompressionOptionsWidget::sortByType() const
+{
+    return sortByTypeCheckBox->isEnabled() && sortByTypeCheckBox->isChecked();
+}
+
 void CompressionOptionsWidget::setEncryptionVisible(bool visible)
 {
     collapsibleEncryption->setVisible(visible);
@@ -185,6 +193,9 @@ void CompressionOptionsWidget::updateWidgets()
             compMethodComboBox->setCurrentText(archiveFormat.defaultCompressionMethod());
         }
     }
+    // Only formats which compress all the files as a single stream benefit from the ordering.
+    const bool isSolid = m_mimetype.name() == QLatin1String("application/x-7z-compressed") || m_mimetype.name().endsWith(QLatin1String("-compressed-tar"));
+    sortByTypeCheckBox->setEnabled(isSolid);
     collapsibleCompression->setEnabled(compLevelSlider->isEnabled() || compMethodComboBox->isEnabled());
 
     if (archiveFormat.supportsMultiVolume()) {
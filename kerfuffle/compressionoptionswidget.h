@@ -27,6 +27,7 @@ public:
     QString compressionMethod() const;
     QString encryptionMethod() const;
     ulong volumeSize() const;
+    bool sortByType() const;
     QString password() const;
     CompressionOptions commpressionOptions() const;
     bool isEncryptionAvailable() const;
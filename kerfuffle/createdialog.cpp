@@ -163,6 +163,11 @@ ulong CreateDialog::volumeSize() const
     return m_ui->optionsWidget->volumeSize();
 }
 
+bool CreateDialog::sortByType() const
+{
+    return m_ui->optionsWidget->sortByType();
+}
+
 QString CreateDialog::password() const
 {
     return m_ui->optionsWidget->password();
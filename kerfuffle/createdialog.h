@@ -39,6 +39,7 @@ public:
     QString compressionMethod() const;
     QString encryptionMethod() const;
     ulong volumeSize() const;
+    bool sortByType() const;
 
     /**
      * @return Whether the user can encrypt the new archive.
@@ -0,0 +1,331 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "filemanifest.h"
+#include "ark_debug.h"
+
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QThread>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <thread>
+
+#ifdef Q_OS_UNIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace Kerfuffle
+{
+namespace
+{
+QString childPath(const QString &directory, const QString &name)
+{
+    return directory.endsWith(QLatin1Char('/')) ? directory + name : directory + QLatin1Char('/') + name;
+}
+
+#ifdef Q_OS_UNIX
+/**
+ * Lists @p directory with a single directory fd: readdir() (getdents64 on Linux)
+ * plus fstatat() relative to it, so that paths are not resolved again for every child.
+ */
+std::vector<FileManifest::Item> listDirectory(const QString &directory)
+{
+    std::vector<FileManifest::Item> items;
+
+    const int fd = ::open(QFile::encodeName(directory).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return items;
+    }
+    DIR *dir = fdopendir(fd);
+    if (!dir) {
+        ::close(fd);
+        return items;
+    }
+
+    while (const struct dirent *entry = readdir(dir)) {
+        const char *name = entry->d_name;
+        if (!strcmp(name, ".") || !strcmp(name, "..")) {
+            continue;
+        }
+
+        FileManifest::Item item;
+        if (fstatat(fd, name, &item.st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+        item.isSymLink = S_ISLNK(item.st.st_mode);
+        item.isDir = S_ISDIR(item.st.st_mode);
+
+        mode_t targetMode = item.st.st_mode;
+        if (item.isSymLink) {
+            struct stat target;
+            if (fstatat(fd, name, &target, 0) != 0) {
+                // Broken symlink.
+                continue;
+            }
+            targetMode = target.st_mode;
+        }
+        // Sockets, fifos and devices.
+        if (!S_ISDIR(targetMode) && !S_ISREG(targetMode)) {
+            continue;
+        }
+        if (faccessat(fd, name, R_OK, 0) != 0) {
+            continue;
+        }
+
+        item.isDirOrLinkToDir = S_ISDIR(targetMode);
+        item.size = item.st.st_size;
+        item.hasStat = true;
+        item.path = childPath(directory, QFile::decodeName(name));
+        items.push_back(std::move(item));
+    }
+
+    closedir(dir);
+    return items;
+}
+#else
+std::vector<FileManifest::Item> listDirectory(const QString &directory)
+{
+    std::vector<FileManifest::Item> items;
+
+    QDirIterator it(directory, QDir::AllEntries | QDir::Readable | QDir::Hidden | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+
+        FileManifest::Item item;
+        item.isSymLink = info.isSymLink();
+        item.isDir = info.isDir() && !item.isSymLink;
+        item.isDirOrLinkToDir = info.isDir();
+        item.size = info.size();
+        item.path = childPath(directory, it.fileName());
+        items.push_back(std::move(item));
+    }
+
+    return items;
+}
+#endif
+
+FileManifest::Item topLevelItem(const QString &path)
+{
+    FileManifest::Item item;
+    item.path = path;
+    item.isTopLevel = true;
+    const QFileInfo info(path);
+    item.isSymLink = info.isSymLink();
+    item.isDir = info.isDir() && !item.isSymLink;
+    item.isDirOrLinkToDir = info.isDir();
+    item.size = info.size();
+#ifndef Q_OS_WIN
+    item.hasStat = (lstat(QFile::encodeName(path).constData(), &item.st) == 0); // krazy:exclude=syscalls
+#endif
+    return item;
+}
+
+/**
+ * Lists directories on several threads, every thread taking the next directory
+ * from a shared queue and queueing the subdirectories it finds.
+ */
+class Walker
+{
+public:
+    explicit Walker(QThread *caller)
+        : m_caller(caller)
+    {
+    }
+
+    void walk(const QStringList &directories, int threadCount)
+    {
+        m_queue.assign(directories.cbegin(), directories.cend());
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < threadCount; ++i) {
+            threads.emplace_back(&Walker::work, this);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+
+    /**
+     * Moves the children of @p directory, recursively, to @p items.
+     */
+    void takeTree(const QString &directory, std::vector<FileManifest::Item> &items)
+    {
+        const auto it = m_listings.find(directory);
+        if (it == m_listings.end()) {
+            return;
+        }
+
+        std::vector<FileManifest::Item> children = std::move(it.value());
+        m_listings.erase(it);
+        for (auto &child : children) {
+            const bool isDir = child.isDir;
+            const QString path = child.path;
+            items.push_back(std::move(child));
+            if (isDir) {
+                takeTree(path, items);
+            }
+        }
+    }
+
+private:
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_condition.wait(lock, [this] {
+                return !m_queue.empty() || m_busyThreads == 0;
+            });
+            if (m_queue.empty() || m_caller->isInterruptionRequested()) {
+                // Nothing left to list and nobody is going to queue anything.
+                m_queue.clear();
+                m_condition.notify_all();
+                return;
+            }
+
+            const QString directory = m_queue.front();
+            m_queue.pop_front();
+            ++m_busyThreads;
+            lock.unlock();
+
+            std::vector<FileManifest::Item> items = listDirectory(directory);
+
+            lock.lock();
+            for (const auto &item : items) {
+                if (item.isDir) {
+                    m_queue.push_back(item.path);
+                }
+            }
+            m_listings.insert(directory, std::move(items));
+            --m_busyThreads;
+            m_condition.notify_all();
+        }
+    }
+
+    QThread *m_caller;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<QString> m_queue;
+    int m_busyThreads = 0;
+    QHash<QString, std::vector<FileManifest::Item>> m_listings;
+};
+}
+
+QSharedPointer<const FileManifest> FileManifest::scan(const QStringList &paths)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    auto manifest = QSharedPointer<FileManifest>::create();
+    manifest->m_roots = paths;
+
+    std::vector<Item> roots;
+    QStringList directories;
+    for (const QString &path : paths) {
+        Item item = topLevelItem(path);
+        // Like QDirIterator, the contents of a symlink to a directory are listed if it was given explicitly.
+        if (item.isDirOrLinkToDir) {
+            directories << path;
+        }
+        roots.push_back(std::move(item));
+    }
+
+    Walker walker(QThread::currentThread());
+    walker.walk(directories, std::clamp(QThread::idealThreadCount(), 1, 8));
+
+    for (auto &root : roots) {
+        const bool isDir = root.isDirOrLinkToDir;
+        const QString path = root.path;
+        manifest->m_items.push_back(std::move(root));
+        if (isDir) {
+            walker.takeTree(path, manifest->m_items);
+        }
+    }
+
+    qCDebug(ARK_LOG) << "Scanned" << manifest->m_items.size() << "entries in" << timer.elapsed() << "ms";
+    return manifest;
+}
+
+QSharedPointer<const FileManifest> FileManifest::statPaths(const QStringList &paths)
+{
+    auto manifest = QSharedPointer<FileManifest>::create();
+    manifest->m_roots = paths;
+    manifest->m_items.reserve(paths.size());
+    for (const QString &path : paths) {
+        manifest->m_items.push_back(topLevelItem(path));
+    }
+    return manifest;
+}
+
+QStringList FileManifest::roots() const
+{
+    return m_roots;
+}
+
+const std::vector<FileManifest::Item> &FileManifest::items() const
+{
+    return m_items;
+}
+
+QSharedPointer<const FileManifest> FileManifest::filtered(const std::function<bool(const Item &)> &keep) const
+{
+    auto manifest = QSharedPointer<FileManifest>::create();
+    manifest->m_roots = m_roots;
+    std::copy_if(m_items.cbegin(), m_items.cend(), std::back_inserter(manifest->m_items), keep);
+    return manifest;
+}
+
+QSharedPointer<const FileManifest> FileManifest::sortedByType() const
+{
+    struct Key {
+        QStringView extension;
+        QStringView name;
+        size_t index;
+    };
+
+    std::vector<Key> files;
+    auto manifest = QSharedPointer<FileManifest>::create();
+    manifest->m_roots = m_roots;
+    manifest->m_items.reserve(m_items.size());
+
+    // Directories keep their order, so that they still precede their contents.
+    for (size_t i = 0; i < m_items.size(); ++i) {
+        const Item &item = m_items[i];
+        if (item.isDir) {
+            manifest->m_items.push_back(item);
+            continue;
+        }
+        const QStringView path(item.path);
+        const QStringView name = path.mid(path.lastIndexOf(QLatin1Char('/')) + 1);
+        const qsizetype dot = name.lastIndexOf(QLatin1Char('.'));
+        files.push_back({dot > 0 ? name.mid(dot + 1) : QStringView(), name, i});
+    }
+
+    std::stable_sort(files.begin(), files.end(), [](const Key &a, const Key &b) {
+        if (const int result = a.extension.compare(b.extension, Qt::CaseInsensitive)) {
+            return result < 0;
+        }
+        return a.name.compare(b.name) < 0;
+    });
+
+    for (const Key &file : files) {
+        manifest->m_items.push_back(m_items[file.index]);
+    }
+    return manifest;
+}
+
+}
@@ -0,0 +1,93 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef FILEMANIFEST_H
+#define FILEMANIFEST_H
+
+#include "kerfuffle_export.h"
+
+#include <QSharedPointer>
+#include <QStringList>
+
+#include <sys/stat.h>
+
+#include <functional>
+#include <vector>
+
+namespace Kerfuffle
+{
+/**
+ * The files and directories to be added to an archive, collected by a single
+ * recursive walk of the filesystem.
+ *
+ * The manifest is built by AddJob, which needs the number of entries, and then
+ * handed to the plugins through CompressionOptions so that they don't walk the tree again.
+ */
+class KERFUFFLE_EXPORT FileManifest
+{
+public:
+    struct Item {
+        /**
+         * The path as it should be added: the path given to scan() for top-level items,
+         * or that path followed by the path of the item within it.
+         */
+        QString path;
+        bool isTopLevel = false;
+        // A real directory, not a symlink to one.
+        bool isDir = false;
+        bool isSymLink = false;
+        // A directory or a symlink pointing to one.
+        bool isDirOrLinkToDir = false;
+        qint64 size = 0;
+        // Result of lstat(), only valid if hasStat is true.
+        struct stat st;
+        bool hasStat = false;
+    };
+
+    /**
+     * Walks @p paths and all their children, which are listed on several threads.
+     * Paths that are relative are resolved against the current directory.
+     *
+     * Like QDirIterator with QDir::AllEntries | QDir::Readable | QDir::Hidden, children
+     * that are not readable, broken symlinks and special files are left out,
+     * and symlinks to directories are not followed.
+     *
+     * Items are listed in depth-first order, every directory before its contents.
+     */
+    static QSharedPointer<const FileManifest> scan(const QStringList &paths);
+
+    /**
+     * @return A manifest of @p paths only: directories are added without their contents.
+     */
+    static QSharedPointer<const FileManifest> statPaths(const QStringList &paths);
+
+    /**
+     * @return The paths scan() was called with.
+     */
+    QStringList roots() const;
+
+    const std::vector<Item> &items() const;
+
+    /**
+     * @return A manifest with the same roots, keeping only the items for which @p keep returns true.
+     */
+    QSharedPointer<const FileManifest> filtered(const std::function<bool(const Item &)> &keep) const;
+
+    /**
+     * @return A manifest with the same items, the directories first and then the files
+     *         grouped by extension and by name, like 7-Zip's -mqs switch does.
+     *         In a solid archive similar files then end up next to each other.
+     */
+    QSharedPointer<const FileManifest> sortedByType() const;
+
+private:
+    QStringList m_roots;
+    std::vector<Item> m_items;
+};
+
+}
+
+#endif // FILEMANIFEST_H
@@ -9,9 +9,10 @@
 
 #include "jobs.h"
 #include "ark_debug.h"
+#include "filemanifest.h"
+#include "pathlistreader.h"
 
 #include <QDir>
-#include <QDirIterator>
 #include <QFileInfo>
 #include <QStorageInfo>
 #include <QThread>
@@ -23,6 +24,9 @@
 
 namespace Kerfuffle
 {
+// Above this, previews are extracted to disk even if they could be extracted to memory.
+constexpr qulonglong MaxInMemoryPreviewSize = 32 * 1024 * 1024;
+
 class Job::Private : public QThread
 {
     Q_OBJECT
@@ -522,7 +526,8 @@ bool CreateJob::doKill()
     if (m_addJob) {
         killed = m_addJob->kill();
 
-        if (killed) {
+        // In update mode the archive existed before, and is left as it was.
+        if (killed && !m_options.isUpdateMode()) {
             // remove leftover archive if needed
             auto archiveFile = QFile(archive()->fileName());
             if (archiveFile.exists()) {
@@ -615,7 +620,6 @@ TempExtractJob::TempExtractJob(Archive::Entry *entry, bool passwordProtectedHint
     , m_entry(entry)
     , m_passwordProtectedHint(passwordProtectedHint)
 {
-    m_tmpExtractDir = new QTemporaryDir();
 }
 
 Archive::Entry *TempExtractJob::entry() const
@@ -656,6 +660,9 @@ ExtractionOptions TempExtractJob::extractionOptions() const
 
 QTemporaryDir *TempExtractJob::tempDir() const
 {
+    if (!m_tmpExtractDir) {
+        m_tmpExtractDir = new QTemporaryDir();
+    }
     return m_tmpExtractDir;
 }
 
@@ -666,6 +673,11 @@ void TempExtractJob::doWork()
 
     connectToArchiveInterfaceSignals();
 
+    extractToTempDir();
+}
+
+void TempExtractJob::extractToTempDir()
+{
     qCDebug(ARK_LOG) << "Extracting:" << m_entry;
 
     bool ret = archiveInterface()->extractFiles({m_entry}, extractionDir(), extractionOptions());
@@ -677,7 +689,7 @@ void TempExtractJob::doWork()
 
 QString TempExtractJob::extractionDir() const
 {
-    return m_tmpExtractDir->path();
+    return tempDir()->path();
 }
 
 PreviewJob::PreviewJob(Archive::Entry *entry, bool passwordProtectedHint, ReadOnlyArchiveInterface *interface)
@@ -686,6 +698,59 @@ PreviewJob::PreviewJob(Archive::Entry *entry, bool passwordProtectedHint, ReadOn
     qCDebug(ARK_LOG) << "Created job instance";
 }
 
+bool PreviewJob::isExtractedToMemory() const
+{
+    return m_isExtractedToMemory;
+}
+
+QByteArray PreviewJob::data() const
+{
+    return m_data;
+}
+
+void PreviewJob::doWork()
+{
+    // Bigger files are better off on disk, where the viewers can read them as they need.
+    // So are files of unknown size, which is 0 in the listing.
+    const qulonglong size = entry()->property("size").toULongLong();
+    if (size == 0 || size > MaxInMemoryPreviewSize || !archiveInterface()->canExtractToMemory(entry())) {
+        TempExtractJob::doWork();
+        return;
+    }
+
+    // pass 1 to i18np on purpose so this translation may properly be reused.
+    Q_EMIT description(this, i18np("Extracting one file", "Extracting %1 files", 1));
+
+    connectToArchiveInterfaceSignals();
+    connect(archiveInterface(), &ReadOnlyArchiveInterface::extractedToMemory, this, [this](const QByteArray &data) {
+        m_data = data;
+        m_isExtractedToMemory = true;
+    });
+
+    qCDebug(ARK_LOG) << "Extracting to memory:" << entry();
+
+    m_isExtractingToMemory = true;
+    bool ret = archiveInterface()->extractToMemory(entry(), extractionOptions(), MaxInMemoryPreviewSize);
+
+    if (!archiveInterface()->waitForFinishedSignal()) {
+        onFinished(ret);
+    }
+}
+
+void PreviewJob::onFinished(bool result)
+{
+    // Errors are only reported by the extraction to disk.
+    if (m_isExtractingToMemory && !result && !error()) {
+        qCDebug(ARK_LOG) << "Could not extract to memory, extracting to a temporary directory instead";
+        m_isExtractingToMemory = false;
+        extractToTempDir();
+        return;
+    }
+
+    m_isExtractingToMemory = false;
+    TempExtractJob::onFinished(result);
+}
+
 OpenJob::OpenJob(Archive::Entry *entry, bool passwordProtectedHint, ReadOnlyArchiveInterface *interface)
     : TempExtractJob(entry, passwordProtectedHint, interface)
 {
@@ -721,31 +786,37 @@ void AddJob::doWork()
         QDir::setCurrent(globalWorkDir);
     }
 
-    // Count total number of entries to be added.
-    uint totalCount = 0;
-    QElapsedTimer timer;
-    timer.start();
-    for (const Archive::Entry *entry : std::as_const(m_entries)) {
-        totalCount++;
-        if (QFileInfo(entry->fullPath()).isDir()) {
-            QDirIterator it(entry->fullPath(), QDir::AllEntries | QDir::Readable | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
-            while (it.hasNext()) {
-                it.next();
-                totalCount++;
-            }
-        }
-    }
+    ReadWriteArchiveInterface *m_writeInterface = qobject_cast<ReadWriteArchiveInterface *>(archiveInterface());
 
-    qCDebug(ARK_LOG) << "Going to add" << totalCount << "entries, counted in" << timer.elapsed() << "ms";
+    Q_ASSERT(m_writeInterface);
 
-    const QString desc = i18np("Compressing a file", "Compressing %1 files", totalCount);
-    Q_EMIT description(this, desc, qMakePair(i18n("Archive"), archiveInterface()->filename()));
+    const bool isFromFileList = !m_options.fileList().isEmpty();
+    if (isFromFileList) {
+        if (m_writeInterface->canAddFromFileList()) {
+            // The files are read from the list while they are added, their number isn't known.
+            qCDebug(ARK_LOG) << "Going to add the files listed in" << m_options.fileList();
+            Q_EMIT description(this, i18n("Compressing files"), qMakePair(i18n("Archive"), archiveInterface()->filename()));
 
-    ReadWriteArchiveInterface *m_writeInterface = qobject_cast<ReadWriteArchiveInterface *>(archiveInterface());
+            connectToArchiveInterfaceSignals();
+            bool ret = m_writeInterface->addFiles(m_entries, m_destination, m_options);
 
-    Q_ASSERT(m_writeInterface);
+            if (!archiveInterface()->waitForFinishedSignal()) {
+                onFinished(ret);
+            }
+            return;
+        }
+
+        if (!readFileList()) {
+            onError(xi18nc("@info", "Could not read the list of files <filename>%1</filename>.", m_options.fileList()), QString());
+            onFinished(false);
+            return;
+        }
+        m_options.setFileList(QString());
+    }
 
     // The file paths must be relative to GlobalWorkDir.
+    QStringList paths;
+    paths.reserve(m_entries.size());
     for (Archive::Entry *entry : std::as_const(m_entries)) {
         // #191821: workDir must be used instead of QDir::current()
         //          so that symlinks aren't resolved automatically
@@ -757,8 +828,23 @@ void AddJob::doWork()
         }
 
         entry->setFullPath(relativePath);
+        paths << relativePath;
     }
 
+    // Walk the entries once: the manifest gives the total number of entries to be added,
+    // and is passed on to the plugin so that it doesn't walk them again.
+    // Like with tar --no-recursion, the directories of a list are added without their contents.
+    QElapsedTimer timer;
+    timer.start();
+    const auto manifest = isFromFileList ? FileManifest::statPaths(paths) : FileManifest::scan(paths);
+    const uint totalCount = manifest->items().size();
+    m_options.setFileManifest(manifest);
+
+    qCDebug(ARK_LOG) << "Going to add" << totalCount << "entries, counted in" << timer.elapsed() << "ms";
+
+    const QString desc = i18np("Compressing a file", "Compressing %1 files", totalCount);
+    Q_EMIT description(this, desc, qMakePair(i18n("Archive"), archiveInterface()->filename()));
+
     connectToArchiveInterfaceSignals();
     bool ret = m_writeInterface->addFiles(m_entries, m_destination, m_options, totalCount);
 
@@ -767,6 +853,24 @@ void AddJob::doWork()
     }
 }
 
+bool AddJob::readFileList()
+{
+    PathListReader reader(m_options.fileList());
+    if (!reader.open()) {
+        qCWarning(ARK_LOG) << "Could not open" << m_options.fileList() << reader.errorString();
+        return false;
+    }
+
+    QString path;
+    while (reader.next(path)) {
+        auto entry = new Archive::Entry(this);
+        entry->setFullPath(path);
+        m_entries << entry;
+    }
+    qCDebug(ARK_LOG) << "Read" << m_entries.size() << "files from" << m_options.fileList();
+    return true;
+}
+
 void AddJob::onFinished(bool result)
 {
     if (!m_oldWorkingDir.isEmpty()) {
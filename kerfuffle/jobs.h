@@ -253,17 +253,25 @@ public:
 public Q_SLOTS:
     void doWork() override;
 
+protected:
+    /**
+     * Extracts the entry to tempDir().
+     */
+    void extractToTempDir();
+
 private:
     QString extractionDir() const;
 
     Archive::Entry *m_entry = nullptr;
-    QTemporaryDir *m_tmpExtractDir = nullptr;
+    // Only created when needed.
+    mutable QTemporaryDir *m_tmpExtractDir = nullptr;
     bool m_passwordProtectedHint;
 };
 
 /**
  * This TempExtractJob can be used to preview a file.
- * The temporary extraction directory will be deleted upon job's completion.
+ * Small files are extracted to memory if the interface supports it, otherwise
+ * the temporary extraction directory will be deleted upon job's completion.
  */
 class KERFUFFLE_EXPORT PreviewJob : public TempExtractJob
 {
@@ -271,6 +279,27 @@ class KERFUFFLE_EXPORT PreviewJob : public TempExtractJob
 
 public:
     PreviewJob(Archive::Entry *entry, bool passwordProtectedHint, ReadOnlyArchiveInterface *interface);
+
+    /**
+     * @return Whether the entry was extracted to memory rather than to tempDir().
+     */
+    bool isExtractedToMemory() const;
+
+    /**
+     * @return The contents of the entry, if isExtractedToMemory().
+     */
+    QByteArray data() const;
+
+public Q_SLOTS:
+    void doWork() override;
+
+protected Q_SLOTS:
+    void onFinished(bool result) override;
+
+private:
+    QByteArray m_data;
+    bool m_isExtractingToMemory = false;
+    bool m_isExtractedToMemory = false;
 };
 
 /**
@@ -307,8 +336,14 @@ protected Q_SLOTS:
     void onFinished(bool result) override;
 
 private:
+    /**
+     * Reads the whole file list of the options into m_entries, for interfaces
+     * that cannot read it while adding.
+     */
+    bool readFileList();
+
     QString m_oldWorkingDir;
-    const QList<Archive::Entry *> m_entries;
+    QList<Archive::Entry *> m_entries;
     const Archive::Entry *m_destination;
     CompressionOptions m_options;
 };
@@ -58,6 +58,11 @@ bool CompressionOptions::isVolumeSizeSet() const
     return volumeSize() > 0;
 }
 
+bool CompressionOptions::isThreadCountSet() const
+{
+    return threadCount() > 0;
+}
+
 int CompressionOptions::compressionLevel() const
 {
     return m_compressionLevel;
@@ -68,6 +73,16 @@ void CompressionOptions::setCompressionLevel(int level)
     m_compressionLevel = level;
 }
 
+int CompressionOptions::threadCount() const
+{
+    return m_threadCount;
+}
+
+void CompressionOptions::setThreadCount(int threads)
+{
+    m_threadCount = threads;
+}
+
 ulong CompressionOptions::volumeSize() const
 {
     return m_volumeSize;
@@ -108,6 +123,46 @@ void CompressionOptions::setGlobalWorkDir(const QString &workDir)
     m_globalWorkDir = workDir;
 }
 
+bool CompressionOptions::isUpdateMode() const
+{
+    return m_updateMode;
+}
+
+void CompressionOptions::setUpdateMode(bool updateMode)
+{
+    m_updateMode = updateMode;
+}
+
+bool CompressionOptions::sortByType() const
+{
+    return m_sortByType;
+}
+
+void CompressionOptions::setSortByType(bool sortByType)
+{
+    m_sortByType = sortByType;
+}
+
+QSharedPointer<const FileManifest> CompressionOptions::fileManifest() const
+{
+    return m_fileManifest;
+}
+
+void CompressionOptions::setFileManifest(const QSharedPointer<const FileManifest> &manifest)
+{
+    m_fileManifest = manifest;
+}
+
+QString CompressionOptions::fileList() const
+{
+    return m_fileList;
+}
+
+void CompressionOptions::setFileList(const QString &fileList)
+{
+    m_fileList = fileList;
+}
+
 QDebug operator<<(QDebug d, const CompressionOptions &options)
 {
     d.nospace() << "(encryption hint: " << options.encryptedArchiveHint();
@@ -122,6 +177,18 @@ QDebug operator<<(QDebug d, const CompressionOptions &options)
     }
     d.nospace() << ", compression level: " << options.compressionLevel();
     d.nospace() << ", volume size: " << options.volumeSize();
+    if (options.isThreadCountSet()) {
+        d.nospace() << ", threads: " << options.threadCount();
+    }
+    if (options.isUpdateMode()) {
+        d.nospace() << ", update mode";
+    }
+    if (options.sortByType()) {
+        d.nospace() << ", sort by type";
+    }
+    if (!options.fileList().isEmpty()) {
+        d.nospace() << ", file list: " << options.fileList();
+    }
     d.nospace() << ")";
     return d.space();
 }
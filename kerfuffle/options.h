@@ -10,9 +10,12 @@
 #include "kerfuffle_export.h"
 
 #include <QDebug>
+#include <QSharedPointer>
 
 namespace Kerfuffle
 {
+class FileManifest;
+
 class KERFUFFLE_EXPORT Options
 {
 public:
@@ -40,8 +43,17 @@ public:
      */
     bool isVolumeSizeSet() const;
 
+    /**
+     * @return Whether a custom number of compression threads has been set in the options.
+     * If false, the plugin decides based on the number of available cores.
+     * @see threadCount()
+     */
+    bool isThreadCountSet() const;
+
     int compressionLevel() const;
     void setCompressionLevel(int level);
+    int threadCount() const;
+    void setThreadCount(int threads);
     ulong volumeSize() const;
     void setVolumeSize(ulong size);
     QString compressionMethod() const;
@@ -61,12 +73,47 @@ public:
      */
     void setGlobalWorkDir(const QString &workDir);
 
+    /**
+     * In update mode, files which are already in the archive with the same size
+     * and modification time are not added again.
+     */
+    bool isUpdateMode() const;
+    void setUpdateMode(bool updateMode);
+
+    /**
+     * Whether the files to add are grouped by type and name instead of being
+     * added in the order they were found. This improves solid compression.
+     */
+    bool sortByType() const;
+    void setSortByType(bool sortByType);
+
+    /**
+     * The files to be added by an AddJob, as found by walking its entries.
+     * Plugins can use it instead of walking the directories again.
+     */
+    QSharedPointer<const FileManifest> fileManifest() const;
+    void setFileManifest(const QSharedPointer<const FileManifest> &manifest);
+
+    /**
+     * A file listing the paths to add, separated by NUL characters, or "-" for the
+     * standard input. The listed files are added instead of the entries of the AddJob,
+     * and directories are added without their contents.
+     * @see ReadWriteArchiveInterface::canAddFromFileList()
+     */
+    QString fileList() const;
+    void setFileList(const QString &fileList);
+
 private:
     int m_compressionLevel = -1;
+    int m_threadCount = 0;
     ulong m_volumeSize = 0;
+    bool m_updateMode = false;
+    bool m_sortByType = false;
     QString m_compressionMethod;
     QString m_encryptionMethod;
     QString m_globalWorkDir;
+    QString m_fileList;
+    QSharedPointer<const FileManifest> m_fileManifest;
 };
 
 class KERFUFFLE_EXPORT ExtractionOptions : public Options
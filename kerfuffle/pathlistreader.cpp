@@ -0,0 +1,99 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "pathlistreader.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace Kerfuffle
+{
+static const qsizetype ChunkSize = 64 * 1024;
+
+PathListReader::PathListReader(const QString &listFile)
+    : m_listFile(listFile)
+{
+}
+
+bool PathListReader::open()
+{
+    if (m_listFile == QLatin1String("-")) {
+        return m_file.open(stdin, QIODevice::ReadOnly);
+    }
+
+    m_file.setFileName(m_listFile);
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    if (!m_file.isSequential()) {
+        m_size = m_file.size();
+    }
+    return true;
+}
+
+QString PathListReader::errorString() const
+{
+    return m_file.errorString();
+}
+
+bool PathListReader::next(QString &path)
+{
+    while (true) {
+        const char *start = m_buffer.constData() + m_position;
+        const auto end = static_cast<const char *>(memchr(start, '\0', m_buffer.size() - m_position));
+        if (end) {
+            const qsizetype length = end - start;
+            m_position += length + 1;
+            m_consumed += length + 1;
+            if (length > 0) {
+                path = QFile::decodeName(QByteArray(start, length));
+                return true;
+            }
+            continue;
+        }
+
+        if (m_isAtEnd) {
+            // The last path doesn't need to be terminated.
+            const qsizetype length = m_buffer.size() - m_position;
+            m_position = m_buffer.size();
+            m_consumed += length;
+            if (length > 0) {
+                path = QFile::decodeName(QByteArray(start, length));
+                return true;
+            }
+            return false;
+        }
+
+        if (!fill()) {
+            return false;
+        }
+    }
+}
+
+double PathListReader::progress() const
+{
+    return m_size > 0 ? double(m_consumed) / double(m_size) : -1;
+}
+
+bool PathListReader::fill()
+{
+    // Keep the incomplete path at the end of the buffer, and read more after it.
+    m_buffer.remove(0, m_position);
+    m_position = 0;
+
+    const qsizetype oldSize = m_buffer.size();
+    m_buffer.resize(oldSize + ChunkSize);
+    const qint64 bytesRead = m_file.read(m_buffer.data() + oldSize, ChunkSize);
+    if (bytesRead < 0) {
+        m_buffer.resize(oldSize);
+        return false;
+    }
+    m_buffer.resize(oldSize + bytesRead);
+    m_isAtEnd = (bytesRead == 0);
+    return true;
+}
+
+}
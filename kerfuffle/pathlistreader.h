@@ -0,0 +1,62 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef PATHLISTREADER_H
+#define PATHLISTREADER_H
+
+#include "kerfuffle_export.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+namespace Kerfuffle
+{
+/**
+ * Reads the paths of a list of files separated by NUL characters, such as
+ * the output of "find -print0", one at a time.
+ *
+ * Only a fixed-size buffer is kept in memory, however long the list is.
+ */
+class KERFUFFLE_EXPORT PathListReader
+{
+public:
+    /**
+     * @param listFile The file with the list, or "-" for the standard input.
+     */
+    explicit PathListReader(const QString &listFile);
+
+    bool open();
+    QString errorString() const;
+
+    /**
+     * Reads the next path into @p path. Empty paths are skipped.
+     *
+     * @return false at the end of the list, or if it could not be read.
+     */
+    bool next(QString &path);
+
+    /**
+     * @return The part of the list which has been read, or -1 if the size
+     *         of the list is not known (e.g. it is read from a pipe).
+     */
+    double progress() const;
+
+private:
+    bool fill();
+
+    QString m_listFile;
+    QFile m_file;
+    qint64 m_size = -1;
+    qint64 m_consumed = 0;
+    QByteArray m_buffer;
+    qsizetype m_position = 0;
+    bool m_isAtEnd = false;
+};
+
+}
+
+#endif // PATHLISTREADER_H
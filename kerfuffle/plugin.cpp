@@ -5,9 +5,9 @@
 */
 
 #include "plugin.h"
+#include "clitoolcache.h"
 
 #include <QJsonArray>
-#include <QStandardPaths>
 
 namespace Kerfuffle
 {
@@ -87,7 +87,7 @@ bool Plugin::findExecutables(const QStringList &executables)
             continue;
         }
 
-        if (QStandardPaths::findExecutable(executable).isEmpty()) {
+        if (CliToolCache::findExecutable(executable).isEmpty()) {
             return false;
         }
     }
@@ -6,6 +6,7 @@
 
 #include "pluginmanager.h"
 #include "ark_debug.h"
+#include "clitoolcache.h"
 #include "settings.h"
 
 #include <KSharedConfig>
@@ -124,18 +125,18 @@ QStringList PluginManager::supportedMimeTypes(MimeSortingMode mode) const
     }
 
     // Remove entry for lrzipped tar if lrzip executable not found in path.
-    if (QStandardPaths::findExecutable(QStringLiteral("lrzip")).isEmpty()) {
+    if (CliToolCache::findExecutable(QStringLiteral("lrzip")).isEmpty()) {
         supported.remove(QStringLiteral("application/x-lrzip-compressed-tar"));
     }
 
     // Remove entry for lz4-compressed tar if lz4 executable not found in path.
-    if (QStandardPaths::findExecutable(QStringLiteral("lz4")).isEmpty()) {
+    if (CliToolCache::findExecutable(QStringLiteral("lz4")).isEmpty()) {
         supported.remove(QStringLiteral("application/x-lz4-compressed-tar"));
     }
 
     static bool s_libarchiveHasLzo = libarchiveHasLzo();
     // Remove entry for lzo-compressed tar if libarchive not linked against lzo and lzop executable not found in path.
-    if (!s_libarchiveHasLzo && QStandardPaths::findExecutable(QStringLiteral("lzop")).isEmpty()) {
+    if (!s_libarchiveHasLzo && CliToolCache::findExecutable(QStringLiteral("lzop")).isEmpty()) {
         supported.remove(QStringLiteral("application/x-tzo"));
     }
 
@@ -161,17 +162,17 @@ QStringList PluginManager::supportedWriteMimeTypes(MimeSortingMode mode) const
     }
 
     // Remove entry for lrzipped tar if lrzip executable not found in path.
-    if (QStandardPaths::findExecutable(QStringLiteral("lrzip")).isEmpty()) {
+    if (CliToolCache::findExecutable(QStringLiteral("lrzip")).isEmpty()) {
         supported.remove(QStringLiteral("application/x-lrzip-compressed-tar"));
     }
 
     // Remove entry for lz4-compressed tar if lz4 executable not found in path.
-    if (QStandardPaths::findExecutable(QStringLiteral("lz4")).isEmpty()) {
+    if (CliToolCache::findExecutable(QStringLiteral("lz4")).isEmpty()) {
         supported.remove(QStringLiteral("application/x-lz4-compressed-tar"));
     }
 
     // Remove entry for lzo-compressed tar if libarchive not linked against lzo and lzop executable not found in path.
-    if (!libarchiveHasLzo() && QStandardPaths::findExecutable(QStringLiteral("lzop")).isEmpty()) {
+    if (!libarchiveHasLzo() && CliToolCache::findExecutable(QStringLiteral("lzop")).isEmpty()) {
         supported.remove(QStringLiteral("application/x-tzo"));
     }
 
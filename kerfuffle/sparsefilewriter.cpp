@@ -0,0 +1,124 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "sparsefilewriter.h"
+#include "ark_debug.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef Q_OS_LINUX
+#include <fcntl.h>
+#endif
+
+namespace Kerfuffle
+{
+SparseFileWriter::SparseFileWriter(QFile *file, qint64 expectedSize, const WriteFunction &write)
+    : m_file(file)
+    , m_write(write)
+{
+#ifdef Q_OS_LINUX
+    // Reserve the space without changing the size of the file, which is set by the writes.
+    if (m_file->isOpen() && expectedSize >= PreallocationThreshold) {
+        m_isPreallocated = (fallocate(m_file->handle(), FALLOC_FL_KEEP_SIZE, 0, expectedSize) == 0);
+        if (!m_isPreallocated) {
+            qCDebug(ARK_LOG) << "Could not preallocate" << m_file->fileName() << strerror(errno);
+        }
+    }
+#else
+    Q_UNUSED(expectedSize)
+#endif
+}
+
+bool SparseFileWriter::write(const char *data, qint64 size, qint64 offset)
+{
+    if (offset < 0) {
+        offset = m_offset;
+    } else if (offset > m_offset && m_holeStart < 0) {
+        // The range left out by the caller is a hole as well.
+        m_holeStart = m_offset;
+    }
+
+    // Blocks are aligned to the offset in the file, only whole zero blocks are left out.
+    qint64 dataStart = 0;
+    qint64 position = 0;
+    while (position < size) {
+        const qint64 blockOffset = offset + position;
+        const qint64 length = std::min(size - position, HoleBlockSize - blockOffset % HoleBlockSize);
+        if (length == HoleBlockSize && isZero(data + position, length)) {
+            if (position > dataStart && !writeData(data + dataStart, position - dataStart, offset + dataStart)) {
+                return false;
+            }
+            if (m_holeStart < 0) {
+                m_holeStart = blockOffset;
+            }
+            dataStart = position + length;
+        } else if (m_holeStart >= 0) {
+            closeHole(blockOffset);
+        }
+        position += length;
+    }
+
+    if (size > dataStart && !writeData(data + dataStart, size - dataStart, offset + dataStart)) {
+        return false;
+    }
+    m_offset = std::max(m_offset, offset + size);
+    return true;
+}
+
+bool SparseFileWriter::finish()
+{
+    if (m_holeStart >= 0) {
+        closeHole(m_offset);
+        // Whoever writes the file sets its size, otherwise the hole at its end has to be added.
+        if (!m_write && !m_file->resize(m_offset)) {
+            qCWarning(ARK_LOG) << "Could not resize" << m_file->fileName() << m_file->errorString();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SparseFileWriter::isZero(const char *data, qint64 size)
+{
+    // Most blocks with data fail on the first bytes. Otherwise, comparing the block with itself
+    // shifted by 16 bytes proves that it's all zeros, and memcmp() does that with vector instructions.
+    const qint64 head = std::min<qint64>(size, 16);
+    for (qint64 i = 0; i < head; ++i) {
+        if (data[i]) {
+            return false;
+        }
+    }
+    return size <= head || memcmp(data, data + head, size - head) == 0;
+}
+
+bool SparseFileWriter::writeData(const char *data, qint64 size, qint64 offset)
+{
+    if (m_write) {
+        return m_write(data, size, offset);
+    }
+    if (m_file->pos() != offset && !m_file->seek(offset)) {
+        return false;
+    }
+    return m_file->write(data, size) == size;
+}
+
+void SparseFileWriter::closeHole(qint64 end)
+{
+#ifdef Q_OS_LINUX
+    // Holes are only needed where space has been preallocated, elsewhere nothing has been written.
+    if (m_isPreallocated && end > m_holeStart
+        && fallocate(m_file->handle(), FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, m_holeStart, end - m_holeStart) != 0) {
+        qCDebug(ARK_LOG) << "Could not deallocate a hole in" << m_file->fileName() << strerror(errno);
+    }
+#else
+    Q_UNUSED(end)
+#endif
+    m_holeStart = -1;
+}
+
+}
@@ -0,0 +1,75 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef SPARSEFILEWRITER_H
+#define SPARSEFILEWRITER_H
+
+#include "kerfuffle_export.h"
+
+#include <QFile>
+
+#include <functional>
+
+namespace Kerfuffle
+{
+/**
+ * Writes the data of an extracted file, leaving holes instead of writing
+ * blocks which contain only zeros.
+ *
+ * Files of a known size of at least PreallocationThreshold are preallocated
+ * up front, so that the filesystem can put them in a few contiguous extents.
+ * The zero blocks of a preallocated file are deallocated again.
+ */
+class KERFUFFLE_EXPORT SparseFileWriter
+{
+public:
+    using WriteFunction = std::function<bool(const char *data, qint64 size, qint64 offset)>;
+
+    // Holes are made of whole blocks of this size, the block size of most filesystems.
+    static const qint64 HoleBlockSize = 4096;
+
+    // Smaller files are usually allocated in one go by delayed allocation.
+    static const qint64 PreallocationThreshold = 1024 * 1024;
+
+    /**
+     * @param file The file being extracted. It's written to, unless @p write is given.
+     *             It's also used for preallocating and for making holes, if it's open.
+     * @param expectedSize The uncompressed size of the entry, or -1 if unknown.
+     * @param write Writes the data at the given offset of the file, if the file is written by someone else
+     *              (e.g. libarchive), which also sets the final size of the file.
+     */
+    SparseFileWriter(QFile *file, qint64 expectedSize, const WriteFunction &write = WriteFunction());
+
+    /**
+     * Writes @p size bytes of @p data at @p offset, which defaults to the end of the previous write.
+     * Skipped ranges become holes.
+     */
+    bool write(const char *data, qint64 size, qint64 offset = -1);
+
+    /**
+     * Sets the size of the file if it ends with a hole, and deallocates the last hole.
+     */
+    bool finish();
+
+    /**
+     * @return Whether the @p size bytes at @p data are all zero.
+     */
+    static bool isZero(const char *data, qint64 size);
+
+private:
+    bool writeData(const char *data, qint64 size, qint64 offset);
+    void closeHole(qint64 end);
+
+    QFile *m_file;
+    WriteFunction m_write;
+    qint64 m_offset = 0;
+    qint64 m_holeStart = -1;
+    bool m_isPreallocated = false;
+};
+
+}
+
+#endif // SPARSEFILEWRITER_H
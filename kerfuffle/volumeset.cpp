@@ -0,0 +1,228 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "volumeset.h"
+#include "ark_debug.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#endif
+
+namespace Kerfuffle
+{
+namespace
+{
+// Long enough for the signatures that every volume starts with (e.g. "Rar!\x1A\x07").
+constexpr qsizetype SignatureLength = 6;
+// Long enough for the end of archive header of RAR volumes.
+constexpr qsizetype TailLength = 32;
+
+struct VolumeCheck {
+    bool exists = false;
+    qint64 size = -1;
+    QByteArray head;
+    QByteArray tail;
+};
+
+VolumeCheck checkVolume(const QString &volume)
+{
+    VolumeCheck check;
+
+    QFile file(volume);
+    check.exists = file.exists();
+    if (check.exists && file.open(QIODevice::ReadOnly)) {
+        check.size = file.size();
+        check.head = file.read(SignatureLength);
+        if (file.seek(std::max<qint64>(0, check.size - TailLength))) {
+            check.tail = file.read(TailLength);
+        }
+    }
+    return check;
+}
+
+/**
+ * @return Whether the end of archive header that RAR volumes end with says that
+ *         another volume follows. Volumes of other formats never say so.
+ */
+bool hasNextVolume(const QByteArray &head, const QByteArray &tail)
+{
+    const auto byte = [&tail](qsizetype i) {
+        return static_cast<uchar>(tail.at(i));
+    };
+
+    if (head == QByteArrayLiteral("Rar!\x1A\x07") && tail.size() >= 8) {
+        // RAR 5: CRC32, then header size 3, type 5, header flags and archive flags as single byte vints.
+        const qsizetype end = tail.size();
+        if (byte(end - 4) == 3 && byte(end - 3) == 5) {
+            return byte(end - 1) & 0x01;
+        }
+
+        // RAR 4: CRC16, type 0x7B, flags and header size, which spans the rest of the volume.
+        for (qsizetype i = 0; i + 7 <= end; ++i) {
+            const int headerSize = byte(i + 5) | (byte(i + 6) << 8);
+            if (byte(i + 2) == 0x7B && headerSize == end - i) {
+                return byte(i + 3) & 0x01;
+            }
+        }
+    }
+    return false;
+}
+}
+
+VolumeSet::VolumeSet(const QString &archive, const QStringList &suffixPatterns)
+{
+    const QFileInfo archiveInfo(archive);
+    const QString fileName = archiveInfo.fileName();
+
+    static const QRegularExpression numberPattern(QStringLiteral("\\d+"));
+    const auto escape = [](const QString &text) {
+        return QRegularExpression::escape(text).replace(QLatin1String("\\$Suffix"), QLatin1String("[^./]+"));
+    };
+
+    for (const QString &pattern : suffixPatterns) {
+        const QRegularExpressionMatch patternNumber = numberPattern.match(pattern);
+        if (!patternNumber.hasMatch()) {
+            continue;
+        }
+
+        // e.g. "part01.$Suffix" matches "foo.part3.rar", split into "foo.part", "3" and ".rar".
+        const QRegularExpression volumePattern(QLatin1String("^(.+\\.") + escape(pattern.left(patternNumber.capturedStart())) + QLatin1String(")(\\d+)(")
+                                               + escape(pattern.mid(patternNumber.capturedEnd())) + QLatin1String(")$"));
+        const QRegularExpressionMatch match = volumePattern.match(fileName);
+        if (!match.hasMatch()) {
+            continue;
+        }
+
+        m_isMultiVolume = true;
+        m_head = archiveInfo.path() + QLatin1Char('/') + match.captured(1);
+        m_tail = match.captured(3);
+
+        // Volumes numbered with padding (part01) or without (part1), which a part10 cannot tell.
+        const QString number = match.captured(2);
+        m_width = number.size();
+        if (!number.startsWith(QLatin1Char('0')) && !QFileInfo::exists(volumeName(1))) {
+            m_width = 1;
+        }
+
+        // The set goes up to the last volume found, the ones missing before it are reported by validate().
+        int lastNumber = number.toInt();
+        const QRegularExpression siblingPattern(QLatin1Char('^') + QRegularExpression::escape(QFileInfo(m_head).fileName()) + QLatin1String("(\\d+)")
+                                                + QRegularExpression::escape(m_tail) + QLatin1Char('$'));
+        const QStringList siblings = archiveInfo.dir().entryList(QDir::Files | QDir::Hidden);
+        for (const QString &sibling : siblings) {
+            const QRegularExpressionMatch siblingMatch = siblingPattern.match(sibling);
+            if (siblingMatch.hasMatch()) {
+                lastNumber = std::max(lastNumber, siblingMatch.captured(1).toInt());
+            }
+        }
+        for (int i = 1; i <= lastNumber; ++i) {
+            m_volumes << volumeName(i);
+        }
+
+        qCDebug(ARK_LOG) << "Found" << m_volumes.size() << "volumes of" << archive;
+        break;
+    }
+}
+
+bool VolumeSet::isMultiVolume() const
+{
+    return m_isMultiVolume;
+}
+
+QStringList VolumeSet::volumes() const
+{
+    return m_volumes;
+}
+
+VolumeSet::Status VolumeSet::validate()
+{
+    m_invalidVolume.clear();
+
+    const QList<VolumeCheck> checks = QtConcurrent::blockingMapped<QList<VolumeCheck>>(m_volumes, checkVolume);
+
+    // The volumes of RAR archives all start with the signature, the parts of split 7z archives do not.
+    const bool hasSignature = checks.size() > 1 && checks.at(0).head.size() == SignatureLength && checks.at(0).head == checks.at(1).head;
+
+    m_totalSize = 0;
+    for (int i = 0; i < checks.size(); ++i) {
+        const VolumeCheck &check = checks.at(i);
+        if (!check.exists) {
+            m_invalidVolume = m_volumes.at(i);
+            qCWarning(ARK_LOG) << "Missing volume" << m_invalidVolume;
+            return MissingVolume;
+        }
+        if (check.size <= 0 || (hasSignature && check.head != checks.at(0).head)) {
+            m_invalidVolume = m_volumes.at(i);
+            qCWarning(ARK_LOG) << "Damaged volume" << m_invalidVolume;
+            return DamagedVolume;
+        }
+
+        // Only the last volume is usually smaller, but the tools may still cope with it.
+        if (i > 0 && i < checks.size() - 1 && check.size != checks.at(0).size) {
+            qCWarning(ARK_LOG) << "Volume" << m_volumes.at(i) << "does not have the size of the first one";
+        }
+        m_totalSize += check.size;
+    }
+
+    // Nothing tells that the last volumes of other formats are missing.
+    if (hasNextVolume(checks.constLast().head, checks.constLast().tail)) {
+        m_invalidVolume = volumeName(m_volumes.size() + 1);
+        qCWarning(ARK_LOG) << "Missing volume" << m_invalidVolume << "after the last one found";
+        return MissingVolume;
+    }
+
+    return Complete;
+}
+
+qint64 VolumeSet::totalSize() const
+{
+    return m_totalSize;
+}
+
+QString VolumeSet::invalidVolume() const
+{
+    return m_invalidVolume;
+}
+
+int VolumeSet::indexOf(const QString &fileName) const
+{
+    const QString name = QFileInfo(fileName).fileName();
+    for (int i = 0; i < m_volumes.size(); ++i) {
+        if (QFileInfo(m_volumes.at(i)).fileName() == name) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void VolumeSet::prefetch(int index) const
+{
+    if (index < 0 || index >= m_volumes.size()) {
+        return;
+    }
+
+#ifdef POSIX_FADV_WILLNEED
+    QFile file(m_volumes.at(index));
+    if (file.open(QIODevice::ReadOnly)) {
+        // The whole file: the page cache is shared with the tool.
+        posix_fadvise(file.handle(), 0, 0, POSIX_FADV_WILLNEED);
+    }
+#endif
+}
+
+QString VolumeSet::volumeName(int number) const
+{
+    return m_head + QString::number(number).rightJustified(m_width, QLatin1Char('0')) + m_tail;
+}
+}
@@ -0,0 +1,94 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef VOLUMESET_H
+#define VOLUMESET_H
+
+#include "kerfuffle_export.h"
+
+#include <QStringList>
+
+namespace Kerfuffle
+{
+/**
+ * The volumes of a multi-volume archive, found from their names rather than
+ * by the tool while it reads the archive, so that missing or damaged volumes
+ * are noticed before any work is done.
+ */
+class KERFUFFLE_EXPORT VolumeSet
+{
+public:
+    enum Status {
+        Complete,
+        MissingVolume,
+        DamagedVolume,
+    };
+
+    VolumeSet() = default;
+
+    /**
+     * Finds the volumes of the set that @p archive belongs to.
+     *
+     * @param suffixPatterns How the first volume is named, with $Suffix standing for the
+     *                       extension of the archive (see CliProperties::multiVolumeSuffix).
+     *                       The number in the pattern is the number of the volume.
+     */
+    VolumeSet(const QString &archive, const QStringList &suffixPatterns);
+
+    /**
+     * @return Whether the archive is named like a volume of a multi-volume archive.
+     */
+    bool isMultiVolume() const;
+
+    /**
+     * @return The paths of the volumes, in order, including the missing ones.
+     */
+    QStringList volumes() const;
+
+    /**
+     * Checks the volumes on several threads: they must all be there up to the last
+     * one found next to the archive, none can be empty, and if the volumes of the format
+     * all start with the same signature, each of them must start with it.
+     * The last volume of a RAR archive must also say that no other volume follows.
+     */
+    Status validate();
+
+    /**
+     * @return The volume which made validate() fail.
+     */
+    QString invalidVolume() const;
+
+    /**
+     * @return The size of all the volumes, as found by validate().
+     */
+    qint64 totalSize() const;
+
+    /**
+     * @return The index of the volume named @p fileName, or -1 if it is not a volume of the set.
+     */
+    int indexOf(const QString &fileName) const;
+
+    /**
+     * Hints the kernel to read volume @p index in the background, so that it is
+     * already cached when the tool gets to it.
+     */
+    void prefetch(int index) const;
+
+private:
+    QString volumeName(int number) const;
+
+    // The volumes are named m_head, then their number padded to m_width digits, then m_tail.
+    QString m_head;
+    QString m_tail;
+    int m_width = 1;
+    QStringList m_volumes;
+    QString m_invalidVolume;
+    qint64 m_totalSize = 0;
+    bool m_isMultiVolume = false;
+};
+}
+
+#endif // VOLUMESET_H
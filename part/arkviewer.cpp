@@ -23,11 +23,14 @@
 #include <KXMLGUIFactory>
 
 #include <QAction>
+#include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QMimeDatabase>
 #include <QProgressDialog>
 #include <QPushButton>
 #include <QStyle>
+#include <QTemporaryFile>
 
 #include <algorithm>
 
@@ -169,7 +172,85 @@ void ArkViewer::view(const QString &fileName, const QString &entryPath, const QM
     QFile::remove(fileName);
 }
 
+void ArkViewer::view(const QByteArray &data, const QString &entryPath, const QMimeType &mimeType)
+{
+    qCDebug(ARK_LOG) << "viewing" << data.size() << "bytes from" << entryPath << "with mime type:" << mimeType.name();
+
+    const std::optional<KPluginMetaData> internalViewer = ArkViewer::getInternalViewer(mimeType.name());
+
+    if (internalViewer) {
+        qCDebug(ARK_LOG) << "Opening internal viewer";
+
+        ArkViewer *viewer = new ArkViewer();
+        viewer->show();
+        if (!viewer->viewInInternalViewer(*internalViewer, data, entryPath, mimeType)) {
+            KMessageBox::error(nullptr, i18n("The internal viewer cannot preview this file."));
+            delete viewer;
+        }
+        return;
+    }
+
+    // External viewers can only open files.
+    const QString fileName = writeTemporaryFile(data, entryPath);
+    if (fileName.isEmpty()) {
+        KMessageBox::error(nullptr, i18n("The internal viewer cannot preview this file."));
+        return;
+    }
+
+    view(fileName, entryPath, mimeType);
+}
+
+QString ArkViewer::writeTemporaryFile(const QByteArray &data, const QString &entryPath)
+{
+    // Keep the name of the entry, viewers may rely on its extension.
+    QTemporaryFile file(QDir::tempPath() + QLatin1String("/ark-XXXXXX-") + QFileInfo(entryPath).fileName());
+    file.setAutoRemove(false);
+    if (!file.open() || file.write(data) != data.size()) {
+        qCWarning(ARK_LOG) << "Failed to write temporary file" << file.fileName();
+        file.remove();
+        return QString();
+    }
+
+    return file.fileName();
+}
+
 bool ArkViewer::viewInInternalViewer(const KPluginMetaData &viewer, const QString &fileName, const QString &entryPath, const QMimeType &mimeType)
+{
+    if (!loadPart(viewer, mimeType)) {
+        return false;
+    }
+
+    openFile(fileName, entryPath);
+    return true;
+}
+
+bool ArkViewer::viewInInternalViewer(const KPluginMetaData &viewer, const QByteArray &data, const QString &entryPath, const QMimeType &mimeType)
+{
+    if (!loadPart(viewer, mimeType)) {
+        return false;
+    }
+
+    QUrl url;
+    url.setPath(entryPath);
+    if (m_part.data()->openStream(mimeType.name(), url)) {
+        m_part.data()->writeStream(data);
+        m_part.data()->closeStream();
+        m_part.data()->widget()->setFocus();
+        setWindowTitle(entryPath);
+        return true;
+    }
+
+    // Not all parts can read from memory.
+    const QString fileName = writeTemporaryFile(data, entryPath);
+    if (fileName.isEmpty()) {
+        return false;
+    }
+
+    openFile(fileName, entryPath);
+    return true;
+}
+
+bool ArkViewer::loadPart(const KPluginMetaData &viewer, const QMimeType &mimeType)
 {
     // Set icon and comment for the mimetype.
     m_iconLabel->setPixmap(QIcon::fromTheme(mimeType.iconName()).pixmap(style()->pixelMetric(QStyle::PixelMetric::PM_SmallIconSize)));
@@ -204,6 +285,11 @@ bool ArkViewer::viewInInternalViewer(const KPluginMetaData &viewer, const QStrin
     createGUI(m_part.data());
     setAutoSaveSettings(QStringLiteral("Viewer"), true);
 
+    return true;
+}
+
+void ArkViewer::openFile(const QString &fileName, const QString &entryPath)
+{
     m_part.data()->openUrl(QUrl::fromLocalFile(fileName));
     m_part.data()->widget()->setFocus();
     m_fileName = fileName;
@@ -211,8 +297,6 @@ bool ArkViewer::viewInInternalViewer(const KPluginMetaData &viewer, const QStrin
     // Needs to come after openUrl to override the part-provided caption
     setWindowTitle(entryPath);
     setWindowFilePath(fileName);
-
-    return true;
 }
 
 KService::Ptr ArkViewer::getExternalViewer(const QString &mimeType)
@@ -29,6 +29,12 @@ public:
 
     static void view(const QString &fileName, const QString &entryPath = QString(), const QMimeType &mimeType = QMimeType());
 
+    /**
+     * Views the contents @p data of the file @p entryPath. They are only written
+     * to a temporary file if the viewer cannot read them from memory.
+     */
+    static void view(const QByteArray &data, const QString &entryPath, const QMimeType &mimeType);
+
 private:
     explicit ArkViewer();
 
@@ -41,7 +47,16 @@ private:
 
     static bool askViewAsPlainText(const QMimeType &mimeType);
 
+    /**
+     * @return The path of a new temporary file with the contents @p data and the name of @p entryPath,
+     *         or an empty string if it could not be written.
+     */
+    static QString writeTemporaryFile(const QByteArray &data, const QString &entryPath);
+
+    bool loadPart(const KPluginMetaData &viewer, const QMimeType &mimeType);
+    void openFile(const QString &fileName, const QString &entryPath);
     bool viewInInternalViewer(const KPluginMetaData &viewer, const QString &fileName, const QString &entryPath, const QMimeType &mimeType);
+    bool viewInInternalViewer(const KPluginMetaData &viewer, const QByteArray &data, const QString &entryPath, const QMimeType &mimeType);
 
 private Q_SLOTS:
     void aboutKPart();
@@ -725,6 +725,9 @@ void Part::readCompressionOptions()
     if (!m_compressionOptions.isVolumeSizeSet() && arguments().metaData().contains(QStringLiteral("volumeSize"))) {
         m_compressionOptions.setVolumeSize(arguments().metaData()[QStringLiteral("volumeSize")].toULong());
     }
+    if (arguments().metaData().contains(QStringLiteral("sortByType"))) {
+        m_compressionOptions.setSortByType(arguments().metaData()[QStringLiteral("sortByType")] == QLatin1String("true"));
+    }
 
     const auto compressionMethods = m_model->archive()->property("compressionMethods").toStringList();
     qCDebug(ARK_LOG) << "compmethods:" << compressionMethods;
@@ -1034,13 +1037,20 @@ void Part::slotPreviewExtractedEntry(KJob *job)
         PreviewJob *previewJob = qobject_cast<PreviewJob *>(job);
         Q_ASSERT(previewJob);
 
-        m_tmpExtractDirList << previewJob->tempDir();
         // Use displayName to detect the mimetype, otherwise with single-file archives with fake 'data' entry the detected mime would be the default one.
         QMimeType mimeType = QMimeDatabase().mimeTypeForFile(previewJob->entry()->displayName());
+        QString entryPath;
         if (previewJob->entry()->displayName() != previewJob->entry()->name()) {
-            ArkViewer::view(previewJob->validatedFilePath(), previewJob->entry()->displayName(), mimeType);
+            entryPath = previewJob->entry()->displayName();
+        } else {
+            entryPath = previewJob->entry()->fullPath(PathFormat::NoTrailingSlash);
+        }
+
+        if (previewJob->isExtractedToMemory()) {
+            ArkViewer::view(previewJob->data(), entryPath, mimeType);
         } else {
-            ArkViewer::view(previewJob->validatedFilePath(), previewJob->entry()->fullPath(PathFormat::NoTrailingSlash), mimeType);
+            m_tmpExtractDirList << previewJob->tempDir();
+            ArkViewer::view(previewJob->validatedFilePath(), entryPath, mimeType);
         }
 
     } else if (job->error() != KJob::KilledJobError) {
@@ -8,6 +8,7 @@
 
 #include "cliplugin.h"
 #include "ark_debug.h"
+#include "clitoolcache.h"
 
 #include <QDateTime>
 #include <QDir>
@@ -48,30 +49,11 @@ void CliPlugin::setupCliProperties()
 {
     qCDebug(ARK_LOG) << "Setting up parameters...";
 
-    if (m_binaryVariant == Undefined) {
-        qCDebug(ARK_LOG) << "Checking 7z variant...";
-        QProcess process;
-        process.setProgram(QStringLiteral("7z"));
-        process.start();
-        process.waitForFinished(500);
-        const QString output = QString::fromUtf8(process.readAllStandardOutput());
-        if (output.contains(QLatin1String("p7zip"))) {
-            qCDebug(ARK_LOG) << "Detected p7zip variant.";
-            m_binaryVariant = P7zip;
-        } else if (output.contains(QLatin1String("7-Zip"))) {
-            qCDebug(ARK_LOG) << "Detected upstream 7-Zip variant.";
-            m_binaryVariant = Upstream7zip;
-        }
-    }
-
     m_cliProps->setProperty("captureProgress", false);
 
+    // The switches that depend on the variant of 7z are only set once it is needed, see detectBinaryVariant().
     m_cliProps->setProperty("addProgram", QStringLiteral("7z"));
-    QStringList addSwitch = {QStringLiteral("a")};
-    if (m_binaryVariant == P7zip) {
-        addSwitch << QStringLiteral("-l");
-    }
-    m_cliProps->setProperty("addSwitch", addSwitch);
+    m_cliProps->setProperty("addSwitch", QStringList{QStringLiteral("a")});
 
     m_cliProps->setProperty("deleteProgram", QStringLiteral("7z"));
     m_cliProps->setProperty("deleteSwitch", QStringLiteral("d"));
@@ -79,6 +61,7 @@ void CliPlugin::setupCliProperties()
     m_cliProps->setProperty("extractProgram", QStringLiteral("7z"));
     m_cliProps->setProperty("extractSwitch", QStringList{QStringLiteral("x")});
     m_cliProps->setProperty("extractSwitchNoPreserve", QStringList{QStringLiteral("e")});
+    m_cliProps->setProperty("extractToStdoutSwitch", QStringList{QStringLiteral("e"), QStringLiteral("-so")});
 
     m_cliProps->setProperty("listProgram", QStringLiteral("7z"));
     m_cliProps->setProperty("listSwitch", QStringList{QStringLiteral("l"), QStringLiteral("-slt")});
@@ -99,6 +82,8 @@ void CliPlugin::setupCliProperties()
                             QHash<QString, QVariant>{{QStringLiteral("application/x-7z-compressed"), QString()},
                                                      {QStringLiteral("application/zip"), QStringLiteral("-mem=$EncryptionMethod")}});
     m_cliProps->setProperty("multiVolumeSwitch", QStringLiteral("-v$VolumeSizek"));
+    m_cliProps->setProperty("sortByTypeSwitch", QStringList{QStringLiteral("-mqs=on")});
+    m_cliProps->setProperty("listFileSwitch", QStringList{QStringLiteral("-scsUTF-8"), QStringLiteral("@$ListFile")});
     m_cliProps->setProperty("testPassedPatterns", QStringList{QStringLiteral("^Everything is Ok$")});
     m_cliProps->setProperty("fileExistsFileNameRegExp", QStringList{QStringLiteral("^file \\./(.*)$"), QStringLiteral("^  Path:     \\./(.*)$")});
     m_cliProps->setProperty("fileExistsInput",
@@ -112,6 +97,42 @@ void CliPlugin::setupCliProperties()
     m_cliProps->setProperty("multiVolumeSuffix", QStringList{QStringLiteral("$Suffix.001")});
 }
 
+void CliPlugin::detectBinaryVariant()
+{
+    if (m_binaryVariant != Undefined) {
+        return;
+    }
+
+    qCDebug(ARK_LOG) << "Checking 7z variant...";
+    // Only the variant is cached, not the whole help text.
+    const QString variant = CliToolCache::probe(QStringLiteral("7z"), {}, [](const QByteArray &output) {
+        if (output.contains("p7zip")) {
+            return QStringLiteral("p7zip");
+        }
+        if (output.contains("7-Zip")) {
+            return QStringLiteral("7-Zip");
+        }
+        return QString();
+    });
+    if (variant == QLatin1String("p7zip")) {
+        qCDebug(ARK_LOG) << "Detected p7zip variant.";
+        m_binaryVariant = P7zip;
+        m_cliProps->setProperty("addSwitch", QStringList{QStringLiteral("a"), QStringLiteral("-l")});
+    } else if (variant == QLatin1String("7-Zip")) {
+        qCDebug(ARK_LOG) << "Detected upstream 7-Zip variant.";
+        m_binaryVariant = Upstream7zip;
+    }
+}
+
+bool CliPlugin::addFiles(const QList<Archive::Entry *> &files,
+                         const Archive::Entry *destination,
+                         const CompressionOptions &options,
+                         uint numberOfEntriesToAdd)
+{
+    detectBinaryVariant();
+    return CliInterface::addFiles(files, destination, options, numberOfEntriesToAdd);
+}
+
 void CliPlugin::fixDirectoryFullName()
 {
     if (m_currentArchiveEntry->isDir()) {
@@ -286,6 +307,10 @@ bool CliPlugin::readListLine(const QString &line)
         } else if (line.startsWith(QLatin1String("Block = ")) || line.startsWith(QLatin1String("Version = "))) {
             m_isFirstInformationEntry = true;
             if (!m_currentArchiveEntry->fullPath().isEmpty()) {
+                // Empty files and folders don't belong to any block.
+                bool isBlock = false;
+                const int block = line.startsWith(QLatin1String("Block = ")) ? QStringView(line).mid(8).trimmed().toInt(&isBlock) : -1;
+                setNextEntryBlock(isBlock ? block : -1);
                 Q_EMIT entry(m_currentArchiveEntry);
             } else {
                 delete m_currentArchiveEntry;
@@ -383,5 +408,12 @@ bool CliPlugin::isFileExistsFileName(const QString &line)
     return (line.startsWith(QLatin1String("file ./")) || line.startsWith(QLatin1String("  Path:     ./")));
 }
 
+bool CliPlugin::canExtractInParallel() const
+{
+    // The files of other formats are either in a single stream, or can't be told apart
+    // from the ones of a solid block.
+    return m_archiveType == ArchiveType7z || m_archiveType == ArchiveTypeZip;
+}
+
 #include "cliplugin.moc"
 #include "moc_cliplugin.cpp"
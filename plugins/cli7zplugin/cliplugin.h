@@ -20,6 +20,10 @@ public:
     ~CliPlugin() override;
 
     void resetParsing() override;
+    bool addFiles(const QList<Kerfuffle::Archive::Entry *> &files,
+                  const Kerfuffle::Archive::Entry *destination,
+                  const Kerfuffle::CompressionOptions &options,
+                  uint numberOfEntriesToAdd = 0) override;
     bool readListLine(const QString &line) override;
     bool readExtractLine(const QString &line) override;
     bool readDeleteLine(const QString &line) override;
@@ -29,6 +33,7 @@ public:
     bool isDiskFullMsg(const QString &line) override;
     bool isFileExistsMsg(const QString &line) override;
     bool isFileExistsFileName(const QString &line) override;
+    bool canExtractInParallel() const override;
 
 private:
     enum ArchiveType {
@@ -56,6 +61,7 @@ private:
     } m_binaryVariant;
 
     void setupCliProperties();
+    void detectBinaryVariant();
     void handleMethods(const QStringList &methods);
     void fixDirectoryFullName();
 
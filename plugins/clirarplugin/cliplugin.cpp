@@ -68,6 +68,7 @@ void CliPlugin::setupCliProperties()
     m_cliProps->setProperty("extractProgram", QStringLiteral("unrar"));
     m_cliProps->setProperty("extractSwitch", QStringList{QStringLiteral("x"), QStringLiteral("-kb"), QStringLiteral("-p-")});
     m_cliProps->setProperty("extractSwitchNoPreserve", QStringList{QStringLiteral("e"), QStringLiteral("-kb"), QStringLiteral("-p-")});
+    m_cliProps->setProperty("extractToStdoutSwitch", QStringList{QStringLiteral("p"), QStringLiteral("-inul"), QStringLiteral("-p-")});
 
     m_cliProps->setProperty("listProgram", QStringLiteral("unrar"));
     m_cliProps->setProperty("listSwitch", QStringList{QStringLiteral("vt"), QStringLiteral("-v")});
@@ -88,6 +89,8 @@ void CliPlugin::setupCliProperties()
                             QHash<QString, QVariant>{{QStringLiteral("application/vnd.rar"), QStringLiteral("-ma$CompressionMethod")},
                                                      {QStringLiteral("application/x-rar"), QStringLiteral("-ma$CompressionMethod")}});
     m_cliProps->setProperty("multiVolumeSwitch", QStringLiteral("-v$VolumeSizek"));
+    // unrar detects that the list file is in UTF-8.
+    m_cliProps->setProperty("listFileSwitch", QStringList{QStringLiteral("@$ListFile")});
 
     m_cliProps->setProperty("testPassedPatterns", QStringList{QStringLiteral("^All OK$")});
     m_cliProps->setProperty("fileExistsFileNameRegExp",
@@ -531,6 +534,11 @@ void CliPlugin::handleUnrar4Entry()
 
 bool CliPlugin::readExtractLine(const QString &line)
 {
+    if (line.startsWith(QLatin1String("Extracting from "))) {
+        volumeOpened(line.mid(16));
+        return true;
+    }
+
     if (line.contains(QLatin1String("CRC failed"))) {
         Q_EMIT error(i18n("One or more wrong checksums"));
         return false;
@@ -593,5 +601,12 @@ bool CliPlugin::isLocked() const
     return m_isLocked;
 }
 
+bool CliPlugin::canExtractInParallel() const
+{
+    // Every file of a solid archive depends on the ones before it, and the files
+    // spanning the volumes of a multi-volume archive are listed once per volume.
+    return !m_isSolid && !isMultiVolume();
+}
+
 #include "cliplugin.moc"
 #include "moc_cliplugin.cpp"
@@ -30,6 +30,7 @@ public:
     bool isDiskFullMsg(const QString &line) override;
     bool isFileExistsMsg(const QString &line) override;
     bool isFileExistsFileName(const QString &line) override;
+    bool canExtractInParallel() const override;
     bool isLocked() const override;
 
 private:
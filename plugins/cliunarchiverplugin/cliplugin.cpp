@@ -10,8 +10,6 @@
 #include "queries.h"
 
 #include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonParseError>
 
 #include <KLocalizedString>
 #include <KPluginFactory>
@@ -26,6 +24,9 @@ K_PLUGIN_CLASS_WITH_JSON(CliPlugin, "kerfuffle_cliunarchiver.json")
 
 CliPlugin::CliPlugin(QObject *parent, const QVariantList &args)
     : CliInterface(parent, args)
+    , m_jsonReader([this](const QJsonObject &item) {
+        readJsonEntry(item);
+    })
 {
     qCDebug(ARK_LOG) << "Loaded cli_unarchiver plugin";
     setupCliProperties();
@@ -62,7 +63,8 @@ bool CliPlugin::extractFiles(const QList<Archive::Entry *> &files, const QString
 
 void CliPlugin::resetParsing()
 {
-    m_jsonOutput.clear();
+    m_jsonReader.reset();
+    m_hasEncryptedEntries = false;
     m_numberOfVolumes = 0;
 }
 
@@ -106,34 +108,28 @@ bool CliPlugin::readExtractLine(const QString &line)
 
 void CliPlugin::setJsonOutput(const QString &jsonOutput)
 {
-    m_jsonOutput = jsonOutput;
+    resetParsing();
+    m_jsonReader.read(jsonOutput.toUtf8());
     readJsonOutput();
 }
 
 void CliPlugin::readStdout(bool handleAll)
 {
-    if (!handleAll) {
-        CliInterface::readStdout(false);
-        return;
-    }
+    CliInterface::readStdout(handleAll);
 
-    // We are ready to read the json output.
-    readJsonOutput();
+    if (handleAll && m_operationMode == List) {
+        // We are ready to read the rest of the json output.
+        readJsonOutput();
+    }
 }
 
 bool CliPlugin::handleLine(const QString &line)
 {
-    // Collect the json output line by line.
+    // #372210: lsar can generate huge JSONs for big archives, so the json
+    // output is parsed line by line and the entries are emitted as they come.
     if (m_operationMode == List) {
-        // #372210: lsar can generate huge JSONs for big archives.
-        // We can at least catch a bad_alloc here in order to not crash.
-        try {
-            m_jsonOutput += line + QLatin1Char('\n');
-        } catch (const std::bad_alloc &) {
-            m_jsonOutput.clear();
-            Q_EMIT error(i18n("Not enough memory for loading the archive."));
-            return false;
-        }
+        m_jsonReader.read(line.toUtf8());
+        m_jsonReader.read("\n");
     }
 
     if (m_operationMode == List) {
@@ -167,6 +163,7 @@ void CliPlugin::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
     if (m_process) {
         // handle all the remaining data in the process
         readStdout(true);
+        readStderr(true);
 
         delete m_process;
         m_process = nullptr;
@@ -201,15 +198,12 @@ void CliPlugin::processFinished(int exitCode, QProcess::ExitStatus exitStatus)
 
 void CliPlugin::readJsonOutput()
 {
-    QJsonParseError error;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(m_jsonOutput.toUtf8(), &error);
-
-    if (error.error != QJsonParseError::NoError) {
-        qCDebug(ARK_LOG) << "Could not parse json output:" << error.errorString();
+    if (!m_jsonReader.isComplete()) {
+        qCDebug(ARK_LOG) << "Could not parse json output: the output is incomplete";
         return;
     }
 
-    const QJsonObject json = jsonDoc.object();
+    const QJsonObject json = m_jsonReader.properties();
 
     const QJsonObject properties = json.value(QStringLiteral("lsarProperties")).toObject();
     const QJsonArray volumes = properties.value(QStringLiteral("XADVolumes")).toArray();
@@ -219,45 +213,46 @@ void CliPlugin::readJsonOutput()
         setMultiVolume(true);
     }
 
-    QString formatName = json.value(QStringLiteral("lsarFormatName")).toString();
+    // lsar prints the format name after the entries.
+    const QString formatName = json.value(QStringLiteral("lsarFormatName")).toString();
     if (formatName == QLatin1String("RAR")) {
         Q_EMIT compressionMethodFound(QStringLiteral("RAR4"));
     } else if (formatName == QLatin1String("RAR 5")) {
         Q_EMIT compressionMethodFound(QStringLiteral("RAR5"));
     }
-    const QJsonArray entries = json.value(QStringLiteral("lsarContents")).toArray();
-
-    for (const QJsonValue &value : entries) {
-        const QJsonObject currentEntryJson = value.toObject();
 
-        Archive::Entry *currentEntry = new Archive::Entry(this);
-
-        QString filename = currentEntryJson.value(QStringLiteral("XADFileName")).toString();
+    if (m_hasEncryptedEntries) {
+        formatName == QLatin1String("RAR 5") ? Q_EMIT encryptionMethodFound(QStringLiteral("AES256"))
+                                             : Q_EMIT encryptionMethodFound(QStringLiteral("AES128"));
+    }
+}
 
-        currentEntry->setProperty("isDirectory", !currentEntryJson.value(QStringLiteral("XADIsDirectory")).isUndefined());
-        if (currentEntry->isDir()) {
-            filename += QLatin1Char('/');
-        }
+void CliPlugin::readJsonEntry(const QJsonObject &currentEntryJson)
+{
+    Archive::Entry *currentEntry = new Archive::Entry(this);
 
-        currentEntry->setProperty("fullPath", filename);
-
-        // FIXME: archives created from OSX (i.e. with the __MACOSX folder) list each entry twice, the 2nd time with size 0
-        currentEntry->setProperty("size", currentEntryJson.value(QStringLiteral("XADFileSize")));
-        currentEntry->setProperty("compressedSize", currentEntryJson.value(QStringLiteral("XADCompressedSize")));
-        currentEntry->setProperty("timestamp", currentEntryJson.value(QStringLiteral("XADLastModificationDate")).toVariant());
-        currentEntry->setProperty("size", currentEntryJson.value(QStringLiteral("XADFileSize")));
-        const bool isPasswordProtected = (currentEntryJson.value(QStringLiteral("XADIsEncrypted")).toInt() == 1);
-        currentEntry->setProperty("isPasswordProtected", isPasswordProtected);
-        if (isPasswordProtected) {
-            formatName == QLatin1String("RAR 5") ? Q_EMIT encryptionMethodFound(QStringLiteral("AES256"))
-                                                 : Q_EMIT encryptionMethodFound(QStringLiteral("AES128"));
-        }
-        // TODO: missing fields
+    QString filename = currentEntryJson.value(QStringLiteral("XADFileName")).toString();
 
-        // FIXME: currently with multivolume archives we emit the same entry multiple times because they occur multiple times in the CLI output...
-        // This breaks at least the numberOfEntries() method, and possibly other things.
-        Q_EMIT entry(currentEntry);
+    currentEntry->setProperty("isDirectory", !currentEntryJson.value(QStringLiteral("XADIsDirectory")).isUndefined());
+    if (currentEntry->isDir()) {
+        filename += QLatin1Char('/');
     }
+
+    currentEntry->setProperty("fullPath", filename);
+
+    // FIXME: archives created from OSX (i.e. with the __MACOSX folder) list each entry twice, the 2nd time with size 0
+    currentEntry->setProperty("size", currentEntryJson.value(QStringLiteral("XADFileSize")));
+    currentEntry->setProperty("compressedSize", currentEntryJson.value(QStringLiteral("XADCompressedSize")));
+    currentEntry->setProperty("timestamp", currentEntryJson.value(QStringLiteral("XADLastModificationDate")).toVariant());
+    currentEntry->setProperty("size", currentEntryJson.value(QStringLiteral("XADFileSize")));
+    const bool isPasswordProtected = (currentEntryJson.value(QStringLiteral("XADIsEncrypted")).toInt() == 1);
+    currentEntry->setProperty("isPasswordProtected", isPasswordProtected);
+    m_hasEncryptedEntries |= isPasswordProtected;
+    // TODO: missing fields
+
+    // FIXME: currently with multivolume archives we emit the same entry multiple times because they occur multiple times in the CLI output...
+    // This breaks at least the numberOfEntries() method, and possibly other things.
+    Q_EMIT entry(currentEntry);
 }
 
 bool CliPlugin::isPasswordPrompt(const QString &line)
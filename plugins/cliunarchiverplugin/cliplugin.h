@@ -9,6 +9,7 @@
 #define CLIPLUGIN_H
 
 #include "cliinterface.h"
+#include "lsarjsonreader.h"
 
 class CliPlugin : public Kerfuffle::CliInterface
 {
@@ -43,8 +44,10 @@ private Q_SLOTS:
 private:
     void setupCliProperties();
     void readJsonOutput();
+    void readJsonEntry(const QJsonObject &currentEntryJson);
 
-    QString m_jsonOutput;
+    LsarJsonReader m_jsonReader;
+    bool m_hasEncryptedEntries = false;
 };
 
 #endif // CLIPLUGIN_H
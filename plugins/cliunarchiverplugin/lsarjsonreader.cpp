@@ -0,0 +1,198 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "lsarjsonreader.h"
+#include "ark_debug.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonParseError>
+
+LsarJsonReader::LsarJsonReader(const EntryCallback &onEntry)
+    : m_onEntry(onEntry)
+{
+}
+
+bool LsarJsonReader::read(QByteArrayView data)
+{
+    if (m_hasFailed) {
+        return false;
+    }
+
+    // Only the structure is tracked here: strings are skipped, and the bytes of every
+    // member of the top-level object and of every item of lsarContents are collected
+    // to be parsed by QJsonDocument once they are complete.
+    qsizetype start = 0;
+    for (qsizetype i = 0; i < data.size(); ++i) {
+        const char c = data[i];
+
+        if (m_inString) {
+            if (m_escape) {
+                m_escape = false;
+            } else if (c == '\\') {
+                m_escape = true;
+            } else if (c == '"') {
+                m_inString = false;
+            }
+            continue;
+        }
+
+        switch (c) {
+        case '"':
+            m_inString = true;
+            break;
+        case '{':
+        case '[':
+            ++m_depth;
+            if (m_depth == 1) {
+                m_target = Member;
+                start = i + 1;
+            } else if (m_depth == 3 && m_inContents) {
+                m_target = Item;
+                start = i;
+            }
+            break;
+        case '}':
+        case ']':
+            --m_depth;
+            if (m_depth == 2 && m_target == Item) {
+                collect(data, start, i + 1);
+                if (!readItem()) {
+                    return false;
+                }
+            } else if (m_depth == 1 && m_inContents) {
+                m_inContents = false;
+            } else if (m_depth == 0) {
+                if (m_target == Member) {
+                    collect(data, start, i);
+                    if (!readMember()) {
+                        return false;
+                    }
+                }
+                m_target = None;
+                m_isComplete = true;
+            } else if (m_depth < 0) {
+                m_hasFailed = true;
+                return false;
+            }
+            break;
+        case ':':
+            if (m_depth == 1 && m_target == Member) {
+                collect(data, start, i);
+                start = i;
+                if (!readKey()) {
+                    return false;
+                }
+            }
+            break;
+        case ',':
+            if (m_depth == 1) {
+                if (m_target == Member) {
+                    collect(data, start, i);
+                    if (!readMember()) {
+                        return false;
+                    }
+                }
+                m_target = Member;
+                start = i + 1;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (m_target != None) {
+        collect(data, start, data.size());
+    }
+    return true;
+}
+
+bool LsarJsonReader::isComplete() const
+{
+    return m_isComplete;
+}
+
+QJsonObject LsarJsonReader::properties() const
+{
+    return m_properties;
+}
+
+void LsarJsonReader::reset()
+{
+    m_properties = QJsonObject();
+    m_buffer.clear();
+    m_target = None;
+    m_depth = 0;
+    m_inString = false;
+    m_escape = false;
+    m_inContents = false;
+    m_isComplete = false;
+    m_hasFailed = false;
+}
+
+void LsarJsonReader::collect(QByteArrayView data, qsizetype from, qsizetype to)
+{
+    if (to > from) {
+        m_buffer.append(data.sliced(from, to - from));
+    }
+}
+
+bool LsarJsonReader::readKey()
+{
+    // The buffer holds the key of the member, possibly surrounded by whitespace.
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(QByteArray("[" + m_buffer + "]"), &error);
+    if (error.error != QJsonParseError::NoError || !document.array().at(0).isString()) {
+        qCDebug(ARK_LOG) << "Could not parse json key:" << error.errorString();
+        m_hasFailed = true;
+        return false;
+    }
+
+    if (document.array().at(0).toString() == QLatin1String("lsarContents")) {
+        // The items are read one by one, the member itself is dropped.
+        m_inContents = true;
+        m_target = None;
+        m_buffer.clear();
+    }
+    return true;
+}
+
+bool LsarJsonReader::readMember()
+{
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(QByteArray("{" + m_buffer + "}"), &error);
+    m_buffer.clear();
+    if (error.error != QJsonParseError::NoError) {
+        qCDebug(ARK_LOG) << "Could not parse json output:" << error.errorString();
+        m_hasFailed = true;
+        return false;
+    }
+
+    const QJsonObject member = document.object();
+    for (auto it = member.constBegin(); it != member.constEnd(); ++it) {
+        m_properties.insert(it.key(), it.value());
+    }
+    return true;
+}
+
+bool LsarJsonReader::readItem()
+{
+    QJsonParseError error;
+    const QJsonDocument document = QJsonDocument::fromJson(m_buffer, &error);
+    m_buffer.clear();
+    m_target = None;
+    if (error.error != QJsonParseError::NoError) {
+        qCDebug(ARK_LOG) << "Could not parse json entry:" << error.errorString();
+        m_hasFailed = true;
+        return false;
+    }
+
+    if (document.isObject()) {
+        m_onEntry(document.object());
+    }
+    return true;
+}
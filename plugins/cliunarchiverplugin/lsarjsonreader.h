@@ -0,0 +1,76 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef LSARJSONREADER_H
+#define LSARJSONREADER_H
+
+#include <QByteArray>
+#include <QJsonObject>
+
+#include <functional>
+
+/**
+ * Incremental reader for the output of lsar -json.
+ *
+ * The items of "lsarContents" are handed out one by one as soon as they are
+ * complete, so that neither the whole output nor a document of all the entries
+ * has to be kept in memory. All the other members of the top-level object are
+ * collected and available through properties().
+ */
+class LsarJsonReader
+{
+public:
+    using EntryCallback = std::function<void(const QJsonObject &)>;
+
+    explicit LsarJsonReader(const EntryCallback &onEntry);
+
+    /**
+     * Parses the next chunk of the output.
+     *
+     * @return False if the output is not valid, in which case the rest of it is ignored.
+     */
+    bool read(QByteArrayView data);
+
+    /**
+     * @return Whether the whole top-level object has been read.
+     */
+    bool isComplete() const;
+
+    /**
+     * @return The members of the top-level object other than "lsarContents".
+     */
+    QJsonObject properties() const;
+
+    void reset();
+
+private:
+    enum Target {
+        None,
+        Member,
+        Item,
+    };
+
+    void collect(QByteArrayView data, qsizetype from, qsizetype to);
+    bool readKey();
+    bool readMember();
+    bool readItem();
+
+    EntryCallback m_onEntry;
+    QJsonObject m_properties;
+
+    // The bytes of the member or item being read.
+    QByteArray m_buffer;
+    Target m_target = None;
+
+    int m_depth = 0;
+    bool m_inString = false;
+    bool m_escape = false;
+    bool m_inContents = false;
+    bool m_isComplete = false;
+    bool m_hasFailed = false;
+};
+
+#endif // LSARJSONREADER_H
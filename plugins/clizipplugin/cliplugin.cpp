@@ -78,6 +78,7 @@ void CliPlugin::setupCliProperties()
 
     m_cliProps->setProperty("extractProgram", QStringLiteral("unzip"));
     m_cliProps->setProperty("extractSwitchNoPreserve", QStringList{QStringLiteral("-j")});
+    m_cliProps->setProperty("extractToStdoutSwitch", QStringList{QStringLiteral("-p")});
 
     m_cliProps->setProperty("listProgram", QStringLiteral("zipinfo"));
     m_cliProps->setProperty("listSwitch", QStringList{QStringLiteral("-l"), QStringLiteral("-T"), QStringLiteral("-z")});
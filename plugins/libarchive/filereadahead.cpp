@@ -0,0 +1,114 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "filereadahead.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QtConcurrentRun>
+
+#include <algorithm>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#endif
+
+// Files up to this size are read completely by the workers.
+static const qint64 MaxHeadSize = 1024 * 1024;
+// How far the kernel is asked to read ahead of the current position.
+static const qint64 ReadAheadWindow = 8 * 1024 * 1024;
+// Reading ahead is I/O bound: a few threads are enough to keep the disk queue full
+// without making a rotational disk seek back and forth too much.
+static const int ThreadCount = 4;
+static const std::size_t MaxPendingFiles = 4 * ThreadCount;
+
+FileReadAhead::FileReadAhead(const QStringList &paths)
+    : m_paths(paths)
+{
+    m_threadPool.setMaxThreadCount(ThreadCount);
+    schedule();
+}
+
+FileReadAhead::~FileReadAhead()
+{
+    m_pendingFiles.clear();
+    m_threadPool.waitForDone();
+}
+
+FileReadAhead::File FileReadAhead::take(const QString &path)
+{
+    const auto it = std::find_if(m_pendingFiles.begin(), m_pendingFiles.end(), [&path](const PendingFile &file) {
+        return file.path == path;
+    });
+    if (it == m_pendingFiles.end()) {
+        return File();
+    }
+
+    const File file = it->future.result();
+    // Files before this one have been skipped by the caller.
+    m_pendingFiles.erase(m_pendingFiles.begin(), it + 1);
+    schedule();
+
+    return file;
+}
+
+void FileReadAhead::adviseReadAhead(int fd, qint64 offset)
+{
+#ifdef POSIX_FADV_WILLNEED
+    posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(ReadAheadWindow), POSIX_FADV_WILLNEED);
+#else
+    Q_UNUSED(fd)
+    Q_UNUSED(offset)
+#endif
+}
+
+FileReadAhead::File FileReadAhead::readHead(const QString &path)
+{
+    File result;
+
+    // Directories, symlinks and special files have no data to read.
+    const QFileInfo info(path);
+    if (!info.isFile() || info.isSymLink()) {
+        return result;
+    }
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        return result;
+    }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(file.handle(), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    const qint64 size = file.size();
+    if (size > MaxHeadSize) {
+        adviseReadAhead(file.handle(), MaxHeadSize);
+    }
+
+    result.head.resize(std::min(size, MaxHeadSize));
+    qint64 bytesRead = 0;
+    while (bytesRead < result.head.size()) {
+        const qint64 ret = file.read(result.head.data() + bytesRead, result.head.size() - bytesRead);
+        if (ret <= 0) {
+            break;
+        }
+        bytesRead += ret;
+    }
+    result.head.truncate(bytesRead);
+    result.isComplete = (size <= MaxHeadSize && bytesRead == size);
+    result.isValid = true;
+
+    return result;
+}
+
+void FileReadAhead::schedule()
+{
+    while (m_pendingFiles.size() < MaxPendingFiles && m_nextPath < m_paths.size()) {
+        const QString &path = m_paths.at(m_nextPath++);
+        m_pendingFiles.push_back({path, QtConcurrent::run(&m_threadPool, &FileReadAhead::readHead, path)});
+    }
+}
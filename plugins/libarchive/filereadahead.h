@@ -0,0 +1,66 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef FILEREADAHEAD_H
+#define FILEREADAHEAD_H
+
+#include <QByteArray>
+#include <QFuture>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <deque>
+
+/**
+ * Reads the files about to be added to an archive on worker threads,
+ * so that the thread writing the archive doesn't wait for the disk.
+ *
+ * Small files are read completely, larger ones are only read partially
+ * and the kernel is asked to read ahead the rest.
+ */
+class FileReadAhead
+{
+public:
+    struct File {
+        // The first bytes of the file, or the whole file if isComplete is true.
+        QByteArray head;
+        bool isComplete = false;
+        bool isValid = false;
+    };
+
+    /**
+     * @param paths The files in the order in which they will be taken.
+     */
+    explicit FileReadAhead(const QStringList &paths);
+    ~FileReadAhead();
+
+    /**
+     * @return The data read ahead for @p path, which is not valid if @p path
+     * was not read ahead (e.g. if it is not a regular file).
+     */
+    File take(const QString &path);
+
+    /**
+     * Hints the kernel to read the part of @p fd after @p offset in the background.
+     */
+    static void adviseReadAhead(int fd, qint64 offset);
+
+private:
+    static File readHead(const QString &path);
+    void schedule();
+
+    struct PendingFile {
+        QString path;
+        QFuture<File> future;
+    };
+
+    QStringList m_paths;
+    qsizetype m_nextPath = 0;
+    QThreadPool m_threadPool;
+    std::deque<PendingFile> m_pendingFiles;
+};
+
+#endif // FILEREADAHEAD_H
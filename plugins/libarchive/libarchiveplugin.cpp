@@ -10,6 +10,7 @@
 #include "libarchiveplugin.h"
 #include "ark_debug.h"
 #include "queries.h"
+#include "sparsefilewriter.h"
 #include "windows_stat.h"
 
 #include <KLocalizedString>
@@ -21,6 +22,8 @@
 
 #include <archive_entry.h>
 
+#include <thread>
+
 LibarchivePlugin::LibarchivePlugin(QObject *parent, const QVariantList &args)
     : ReadWriteArchiveInterface(parent, args)
     , m_archiveReadDisk(archive_read_disk_new())
@@ -164,23 +167,44 @@ const QString LibarchivePlugin::uncompressedFileName() const
     return uncompressedName + QLatin1String(".uncompressed");
 }
 
-void LibarchivePlugin::copyDataBlock(const QString &filename, archive *source, archive *dest, bool partialprogress)
+void LibarchivePlugin::copyDataBlock(const QString &filename, archive *source, archive *dest, struct archive_entry *entry, bool partialprogress)
 {
+    // libarchive has created the file already. It's opened a second time to preallocate it
+    // and to deallocate the blocks of zeros, which are not passed to libarchive.
+    // Without a known size the file can't end with a hole, libarchive wouldn't extend it.
+    const bool isSizeKnown = archive_entry_filetype(entry) == AE_IFREG && archive_entry_size_is_set(entry);
+    QFile file(QFile::decodeName(archive_entry_pathname(entry)));
+    if (isSizeKnown && archive_entry_size(entry) >= SparseFileWriter::PreallocationThreshold) {
+        // Append doesn't truncate what libarchive is writing.
+        file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Unbuffered);
+    }
+    SparseFileWriter writer(&file, isSizeKnown ? archive_entry_size(entry) : -1, [dest, &filename](const char *data, qint64 size, qint64 offset) {
+        if (archive_write_data_block(dest, data, static_cast<size_t>(size), offset) < ARCHIVE_OK) {
+            qCCritical(ARK_LOG) << "Error while writing" << filename << ":" << archive_error_string(dest) << "(error no =" << archive_errno(dest) << ')';
+            return false;
+        }
+        return true;
+    });
+
     while (!QThread::currentThread()->isInterruptionRequested()) {
         const void *buff;
         size_t size;
         la_int64_t offset;
         int returnCode = archive_read_data_block(source, &buff, &size, &offset);
         if (returnCode == ARCHIVE_EOF) {
+            writer.finish();
             return;
         }
         if (returnCode < ARCHIVE_OK) {
             qCCritical(ARK_LOG) << "Error while extracting" << filename << ":" << archive_error_string(source) << "(error no =" << archive_errno(source) << ')';
             return;
         }
-        returnCode = archive_write_data_block(dest, buff, size, offset);
-        if (returnCode < ARCHIVE_OK) {
-            qCCritical(ARK_LOG) << "Error while writing" << filename << ":" << archive_error_string(dest) << "(error no =" << archive_errno(dest) << ')';
+        const bool isWritten = isSizeKnown ? writer.write(static_cast<const char *>(buff), static_cast<qint64>(size), offset)
+                                           : archive_write_data_block(dest, buff, size, offset) >= ARCHIVE_OK;
+        if (!isWritten) {
+            if (!isSizeKnown) {
+                qCCritical(ARK_LOG) << "Error while writing" << filename << ":" << archive_error_string(dest) << "(error no =" << archive_errno(dest) << ')';
+            }
             return;
         }
         if (partialprogress) {
@@ -247,7 +271,7 @@ bool LibarchivePlugin::doKill()
 
 bool LibarchivePlugin::extractFiles(const QList<Archive::Entry *> &files, const QString &destinationDirectory, const ExtractionOptions &options)
 {
-    if (!initializeReader()) {
+    if (!initializeReader(true)) {
         return false;
     }
 
@@ -499,7 +523,7 @@ bool LibarchivePlugin::extractFiles(const QList<Archive::Entry *> &files, const
             case ARCHIVE_OK:
                 // If the whole archive is extracted and the total filesize is
                 // available, we use partial progress.
-                copyDataBlock(entryName, m_archiveReader.data(), writer.data(), (extractAll && m_extractedFilesSize));
+                copyDataBlock(entryName, m_archiveReader.data(), writer.data(), entry, (extractAll && m_extractedFilesSize));
                 break;
 
             case ARCHIVE_FAILED:
@@ -558,16 +582,28 @@ bool LibarchivePlugin::extractFiles(const QList<Archive::Entry *> &files, const
     return archive_read_close(m_archiveReader.data()) == ARCHIVE_OK;
 }
 
-bool LibarchivePlugin::initializeReader()
+// Feeds libarchive with the data decoded by the ParallelDecompressor.
+static la_ssize_t readFromDecompressor(struct archive *, void *clientData, const void **buffer)
+{
+    return static_cast<ParallelDecompressor *>(clientData)->read(buffer);
+}
+
+bool LibarchivePlugin::initializeReader(bool parallelDecoding)
 {
     m_archiveReader.reset(archive_read_new());
+    m_parallelDecompressor.reset();
 
     if (!(m_archiveReader.data())) {
         Q_EMIT error(i18n("The archive reader could not be initialized."));
         return false;
     }
 
-    if (archive_read_support_filter_all(m_archiveReader.data()) != ARCHIVE_OK) {
+    if (parallelDecoding) {
+        m_parallelDecompressor = ParallelDecompressor::create(filename(), defaultThreadCount());
+    }
+
+    // The ParallelDecompressor already removes the compression, don't let libarchive guess again.
+    if (!m_parallelDecompressor && archive_read_support_filter_all(m_archiveReader.data()) != ARCHIVE_OK) {
         return false;
     }
 
@@ -583,7 +619,10 @@ bool LibarchivePlugin::initializeReader()
         }
     }
 
-    if (archive_read_open_filename(m_archiveReader.data(), QFile::encodeName(filename()).constData(), 10240) != ARCHIVE_OK) {
+    const int ret = m_parallelDecompressor
+        ? archive_read_open(m_archiveReader.data(), m_parallelDecompressor.get(), nullptr, readFromDecompressor, nullptr)
+        : archive_read_open_filename(m_archiveReader.data(), QFile::encodeName(filename()).constData(), 10240);
+    if (ret != ARCHIVE_OK) {
         qCWarning(ARK_LOG) << "Could not open the archive:" << archive_error_string(m_archiveReader.data());
         Q_EMIT error(i18nc("@info", "Archive corrupted or insufficient permissions."));
         return false;
@@ -592,6 +631,11 @@ bool LibarchivePlugin::initializeReader()
     return true;
 }
 
+int LibarchivePlugin::defaultThreadCount()
+{
+    return std::max(1u, static_cast<unsigned>(std::thread::hardware_concurrency() * 0.8));
+}
+
 void LibarchivePlugin::emitEntryFromArchiveEntry(struct archive_entry *aentry, bool isRawFormat)
 {
     auto e = new Archive::Entry();
@@ -658,34 +702,6 @@ int LibarchivePlugin::extractionFlags() const
     return ARCHIVE_EXTRACT_TIME | ARCHIVE_EXTRACT_SECURE_NOABSOLUTEPATHS | ARCHIVE_EXTRACT_SECURE_NODOTDOT | ARCHIVE_EXTRACT_SECURE_SYMLINKS;
 }
 
-void LibarchivePlugin::copyData(const QString &filename, struct archive *dest, bool partialprogress)
-{
-    char buff[10240];
-    QFile file(filename);
-
-    if (!file.open(QIODevice::ReadOnly)) {
-        return;
-    }
-
-    auto readBytes = file.read(buff, sizeof(buff));
-    while (readBytes > 0 && !QThread::currentThread()->isInterruptionRequested()) {
-        archive_write_data(dest, buff, static_cast<size_t>(readBytes));
-        if (archive_errno(dest) != ARCHIVE_OK) {
-            qCCritical(ARK_LOG) << "Error while writing" << filename << ":" << archive_error_string(dest) << "(error no =" << archive_errno(dest) << ')';
-            return;
-        }
-
-        if (partialprogress) {
-            m_currentExtractedFilesSize += readBytes;
-            Q_EMIT progress(float(m_currentExtractedFilesSize) / m_extractedFilesSize);
-        }
-
-        readBytes = file.read(buff, sizeof(buff));
-    }
-
-    file.close();
-}
-
 void LibarchivePlugin::copyData(const QString &filename, struct archive *source, struct archive *dest, bool partialprogress)
 {
     char buff[10240];
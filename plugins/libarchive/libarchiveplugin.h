@@ -10,11 +10,14 @@
 #define LIBARCHIVEPLUGIN_H
 
 #include "archiveinterface.h"
+#include "paralleldecompressor.h"
 
 #include <archive.h>
 
 #include <QScopedPointer>
 
+#include <memory>
+
 using namespace Kerfuffle;
 
 class LibarchivePlugin : public ReadWriteArchiveInterface
@@ -62,11 +65,23 @@ protected:
     typedef QScopedPointer<struct archive, ArchiveReadCustomDeleter> ArchiveRead;
     typedef QScopedPointer<struct archive, ArchiveWriteCustomDeleter> ArchiveWrite;
 
-    bool initializeReader();
+    /**
+     * Opens the archive for reading.
+     *
+     * @param parallelDecoding Whether to decode independent compressed blocks on several threads.
+     * The compression filter is then not reported by libarchive, so this is only meant for extraction.
+     */
+    bool initializeReader(bool parallelDecoding = false);
+
+    /**
+     * @return Number of threads used for compression or decompression if not set otherwise.
+     */
+    static int defaultThreadCount();
     void emitEntryFromArchiveEntry(struct archive_entry *entry, bool isRawFormat = false);
-    void copyData(const QString &filename, struct archive *dest, bool partialprogress = true);
     void copyData(const QString &filename, struct archive *source, struct archive *dest, bool partialprogress = true);
 
+    // Declared before m_archiveReader, which reads from it.
+    std::unique_ptr<ParallelDecompressor> m_parallelDecompressor;
     ArchiveRead m_archiveReader;
     ArchiveRead m_archiveReadDisk;
 
@@ -78,7 +93,7 @@ private:
     QString convertCompressionName(const QString &method);
     bool emitCorruptArchive();
     const QString uncompressedFileName() const;
-    void copyDataBlock(const QString &filename, struct archive *source, struct archive *dest, bool partialprogress = true);
+    void copyDataBlock(const QString &filename, struct archive *source, struct archive *dest, struct archive_entry *entry, bool partialprogress = true);
 
     int m_cachedArchiveEntryCount;
     qlonglong m_currentExtractedFilesSize;
@@ -0,0 +1,162 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "parallelcompressor.h"
+#include "ark_debug.h"
+
+#include <QIODevice>
+#include <QtConcurrentRun>
+
+#include <zlib.h>
+#if HAVE_BZIP2
+#include <bzlib.h>
+#endif
+
+#include <algorithm>
+
+// Independent gzip members lose the preceding 32 KiB window at every block boundary,
+// which is negligible with blocks of this size.
+static const qsizetype GzipBlockSize = 1024 * 1024;
+
+ParallelCompressor::ParallelCompressor(Format format, int level, int threadCount, QIODevice *device)
+    : m_format(format)
+    , m_level(level)
+    , m_device(device)
+{
+    m_threadPool.setMaxThreadCount(threadCount);
+    // Keep every thread busy while the finished blocks are being written.
+    m_maxPendingBlocks = 2 * static_cast<std::size_t>(threadCount);
+
+    if (m_format == Bzip2) {
+        // One bzip2 stream per block of the chosen size, like pbzip2 does.
+        m_blockSize = std::clamp(m_level < 1 ? 9 : m_level, 1, 9) * 100000;
+    } else {
+        m_blockSize = GzipBlockSize;
+    }
+    m_block.reserve(m_blockSize);
+}
+
+ParallelCompressor::~ParallelCompressor()
+{
+    m_failed = true;
+    m_pendingBlocks.clear();
+    m_threadPool.waitForDone();
+}
+
+bool ParallelCompressor::isSupported(Format format)
+{
+#if HAVE_BZIP2
+    Q_UNUSED(format)
+    return true;
+#else
+    return format == Gzip;
+#endif
+}
+
+bool ParallelCompressor::write(const char *data, qint64 size)
+{
+    while (!m_failed && size > 0) {
+        const qsizetype chunk = std::min<qint64>(size, m_blockSize - m_block.size());
+        m_block.append(data, chunk);
+        data += chunk;
+        size -= chunk;
+
+        if (m_block.size() == m_blockSize) {
+            submitBlock();
+            writeFinishedBlocks(m_maxPendingBlocks);
+        }
+    }
+
+    return !m_failed;
+}
+
+bool ParallelCompressor::close()
+{
+    // Even an empty stream must be a valid gzip/bzip2 file.
+    if (!m_block.isEmpty() || !m_submittedAnyBlock) {
+        submitBlock();
+    }
+
+    return writeFinishedBlocks(0);
+}
+
+void ParallelCompressor::submitBlock()
+{
+    const int level = m_level;
+    auto compress = (m_format == Bzip2) ? &ParallelCompressor::compressBzip2 : &ParallelCompressor::compressGzip;
+    m_pendingBlocks.push_back(QtConcurrent::run(&m_threadPool, compress, m_block, level));
+    m_submittedAnyBlock = true;
+
+    m_block = QByteArray();
+    m_block.reserve(m_blockSize);
+}
+
+bool ParallelCompressor::writeFinishedBlocks(std::size_t maxPendingBlocks)
+{
+    // Blocks are written in order, waiting for the oldest one only when the queue is full.
+    while (!m_failed && !m_pendingBlocks.empty() && (m_pendingBlocks.size() > maxPendingBlocks || m_pendingBlocks.front().isFinished())) {
+        const QByteArray compressed = m_pendingBlocks.front().result();
+        m_pendingBlocks.pop_front();
+
+        if (compressed.isEmpty()) {
+            qCCritical(ARK_LOG) << "Failed to compress block";
+            m_failed = true;
+        } else if (m_device->write(compressed) != compressed.size()) {
+            qCCritical(ARK_LOG) << "Failed to write compressed block:" << m_device->errorString();
+            m_failed = true;
+        }
+    }
+
+    return !m_failed;
+}
+
+QByteArray ParallelCompressor::compressGzip(const QByteArray &block, int level)
+{
+    z_stream stream = {};
+    // 16 + MAX_WBITS makes zlib write a gzip header and trailer around the deflate data.
+    if (deflateInit2(&stream, level < 0 ? Z_DEFAULT_COMPRESSION : level, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return QByteArray();
+    }
+
+    QByteArray compressed(deflateBound(&stream, block.size()), Qt::Uninitialized);
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(block.constData()));
+    stream.avail_in = block.size();
+    stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+    stream.avail_out = compressed.size();
+
+    const int ret = deflate(&stream, Z_FINISH);
+    compressed.truncate(stream.total_out);
+    deflateEnd(&stream);
+
+    return (ret == Z_STREAM_END) ? compressed : QByteArray();
+}
+
+QByteArray ParallelCompressor::compressBzip2(const QByteArray &block, int level)
+{
+#if HAVE_BZIP2
+    // Worst case documented by libbzip2: 1% larger plus 600 bytes.
+    unsigned int compressedSize = block.size() + block.size() / 100 + 600;
+    QByteArray compressed(compressedSize, Qt::Uninitialized);
+
+    const int ret = BZ2_bzBuffToBuffCompress(compressed.data(),
+                                             &compressedSize,
+                                             const_cast<char *>(block.constData()),
+                                             block.size(),
+                                             std::clamp(level < 1 ? 9 : level, 1, 9),
+                                             0,
+                                             0);
+    if (ret != BZ_OK) {
+        return QByteArray();
+    }
+
+    compressed.truncate(compressedSize);
+    return compressed;
+#else
+    Q_UNUSED(block)
+    Q_UNUSED(level)
+    return QByteArray();
+#endif
+}
@@ -0,0 +1,74 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef PARALLELCOMPRESSOR_H
+#define PARALLELCOMPRESSOR_H
+
+#include <QByteArray>
+#include <QFuture>
+#include <QThreadPool>
+
+#include <deque>
+
+class QIODevice;
+
+/**
+ * Compresses a stream on several threads by splitting it into blocks and
+ * compressing every block into an independent gzip member or bzip2 stream.
+ *
+ * The concatenation of members/streams is a valid gzip/bzip2 file,
+ * which is read by the standard single-threaded decoders (pigz and pbzip2 do the same).
+ */
+class ParallelCompressor
+{
+public:
+    enum Format {
+        Gzip,
+        Bzip2,
+    };
+
+    ParallelCompressor(Format format, int level, int threadCount, QIODevice *device);
+    ~ParallelCompressor();
+
+    /**
+     * @return Whether @p format can be compressed in parallel by this build.
+     */
+    static bool isSupported(Format format);
+
+    /**
+     * Queues @p size bytes of @p data for compression.
+     *
+     * @return bool indicating whether the operation was successful.
+     */
+    bool write(const char *data, qint64 size);
+
+    /**
+     * Compresses the remaining data and waits for all the blocks to be written.
+     *
+     * @return bool indicating whether the operation was successful.
+     */
+    bool close();
+
+private:
+    void submitBlock();
+    bool writeFinishedBlocks(std::size_t maxPendingBlocks);
+
+    static QByteArray compressGzip(const QByteArray &block, int level);
+    static QByteArray compressBzip2(const QByteArray &block, int level);
+
+    const Format m_format;
+    const int m_level;
+    QIODevice *m_device;
+    QThreadPool m_threadPool;
+    qsizetype m_blockSize;
+    std::size_t m_maxPendingBlocks;
+    QByteArray m_block;
+    std::deque<QFuture<QByteArray>> m_pendingBlocks;
+    bool m_submittedAnyBlock = false;
+    bool m_failed = false;
+};
+
+#endif // PARALLELCOMPRESSOR_H
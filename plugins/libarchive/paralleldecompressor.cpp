@@ -0,0 +1,771 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "paralleldecompressor.h"
+#include "ark_debug.h"
+
+#include <QFile>
+#include <QtConcurrentRun>
+#include <QtEndian>
+
+#include <zlib.h>
+#if HAVE_BZIP2
+#include <bzlib.h>
+#endif
+#if HAVE_LZMA
+#include <lzma.h>
+#endif
+#if HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+// Units producing more than this are only partially decoded in parallel,
+// the rest is decoded while reading (xz -T uses blocks of 24 MiB by default).
+static const qsizetype MaxBufferedOutput = 32 * 1024 * 1024;
+// What all the units scheduled at once may buffer, however many threads are used.
+static const qsizetype MaxTotalBufferedOutput = 256 * 1024 * 1024;
+static const qsizetype ReadChunkSize = 1024 * 1024;
+static const qint64 ScanChunkSize = 8 * 1024 * 1024;
+// zlib and libbzip2 take the input size as an unsigned int.
+static const size_t MaxInputChunk = 1 << 30;
+
+class ParallelDecompressor::Decoder
+{
+public:
+    enum Status {
+        Ok,
+        StreamEnd,
+        Failed,
+    };
+
+    virtual ~Decoder() = default;
+
+    /**
+     * Decodes from @p input into @p output, advancing @p input and decreasing
+     * @p inputLeft and @p outputLeft by the amount of data consumed and produced.
+     */
+    virtual Status decode(const uchar *&input, size_t &inputLeft, uchar *output, size_t &outputLeft) = 0;
+};
+
+/**
+ * Reads the compressed data of a unit, chunk by chunk, through its own handle on the file.
+ */
+class ParallelDecompressor::UnitReader
+{
+public:
+    UnitReader(const QString &fileName, qint64 offset, qint64 end)
+        : m_file(fileName)
+        , m_position(offset)
+        , m_end(end)
+    {
+    }
+
+    /**
+     * Reads the next chunk of the unit, once the previous one has been consumed.
+     *
+     * @return false if the file could not be read up to the end of the unit.
+     */
+    bool fill()
+    {
+        if (inputLeft > 0 || m_position == m_end) {
+            return true;
+        }
+        if (!m_file.isOpen() && (!m_file.open(QIODevice::ReadOnly | QIODevice::Unbuffered) || !m_file.seek(m_position))) {
+            return false;
+        }
+
+        m_chunk.resize(std::min(m_end - m_position, static_cast<qint64>(ReadChunkSize)));
+        const qint64 bytesRead = m_file.read(m_chunk.data(), m_chunk.size());
+        if (bytesRead <= 0) {
+            return false;
+        }
+
+        m_position += bytesRead;
+        input = reinterpret_cast<const uchar *>(m_chunk.constData());
+        inputLeft = static_cast<size_t>(bytesRead);
+        return true;
+    }
+
+    /**
+     * @return The offset in the file of the first byte which has not been consumed.
+     */
+    qint64 position() const
+    {
+        return m_position - static_cast<qint64>(inputLeft);
+    }
+
+    const uchar *input = nullptr;
+    size_t inputLeft = 0;
+
+private:
+    QFile m_file;
+    QByteArray m_chunk;
+    qint64 m_position;
+    const qint64 m_end;
+};
+
+namespace
+{
+class GzipDecoder : public ParallelDecompressor::Decoder
+{
+public:
+    bool init()
+    {
+        // 16 + MAX_WBITS decodes exactly one gzip member.
+        m_initialized = inflateInit2(&m_stream, 16 + MAX_WBITS) == Z_OK;
+        return m_initialized;
+    }
+
+    ~GzipDecoder() override
+    {
+        if (m_initialized) {
+            inflateEnd(&m_stream);
+        }
+    }
+
+    Status decode(const uchar *&input, size_t &inputLeft, uchar *output, size_t &outputLeft) override
+    {
+        m_stream.next_in = const_cast<Bytef *>(input);
+        m_stream.avail_in = static_cast<uInt>(std::min(inputLeft, MaxInputChunk));
+        m_stream.next_out = output;
+        m_stream.avail_out = static_cast<uInt>(std::min(outputLeft, MaxInputChunk));
+        const uInt availIn = m_stream.avail_in;
+        const uInt availOut = m_stream.avail_out;
+
+        const int ret = inflate(&m_stream, Z_NO_FLUSH);
+
+        input += availIn - m_stream.avail_in;
+        inputLeft -= availIn - m_stream.avail_in;
+        outputLeft -= availOut - m_stream.avail_out;
+
+        switch (ret) {
+        case Z_STREAM_END:
+            return StreamEnd;
+        case Z_OK:
+        case Z_BUF_ERROR:
+            return Ok;
+        default:
+            return Failed;
+        }
+    }
+
+private:
+    z_stream m_stream = {};
+    bool m_initialized = false;
+};
+
+#if HAVE_BZIP2
+class Bzip2Decoder : public ParallelDecompressor::Decoder
+{
+public:
+    bool init()
+    {
+        m_initialized = BZ2_bzDecompressInit(&m_stream, 0, 0) == BZ_OK;
+        return m_initialized;
+    }
+
+    ~Bzip2Decoder() override
+    {
+        if (m_initialized) {
+            BZ2_bzDecompressEnd(&m_stream);
+        }
+    }
+
+    Status decode(const uchar *&input, size_t &inputLeft, uchar *output, size_t &outputLeft) override
+    {
+        m_stream.next_in = reinterpret_cast<char *>(const_cast<uchar *>(input));
+        m_stream.avail_in = static_cast<unsigned int>(std::min(inputLeft, MaxInputChunk));
+        m_stream.next_out = reinterpret_cast<char *>(output);
+        m_stream.avail_out = static_cast<unsigned int>(std::min(outputLeft, MaxInputChunk));
+        const unsigned int availIn = m_stream.avail_in;
+        const unsigned int availOut = m_stream.avail_out;
+
+        const int ret = BZ2_bzDecompress(&m_stream);
+
+        input += availIn - m_stream.avail_in;
+        inputLeft -= availIn - m_stream.avail_in;
+        outputLeft -= availOut - m_stream.avail_out;
+
+        switch (ret) {
+        case BZ_STREAM_END:
+            return StreamEnd;
+        case BZ_OK:
+            return Ok;
+        default:
+            return Failed;
+        }
+    }
+
+private:
+    bz_stream m_stream = {};
+    bool m_initialized = false;
+};
+#endif
+
+#if HAVE_LZMA
+class XzBlockDecoder : public ParallelDecompressor::Decoder
+{
+public:
+    bool init(const uchar *&input, size_t &inputLeft, lzma_check check)
+    {
+        if (inputLeft == 0) {
+            return false;
+        }
+
+        m_block.version = 0;
+        m_block.check = check;
+        m_block.filters = m_filters;
+        m_block.header_size = lzma_block_header_size_decode(input[0]);
+        if (m_block.header_size > inputLeft || lzma_block_header_decode(&m_block, nullptr, input) != LZMA_OK) {
+            return false;
+        }
+
+        input += m_block.header_size;
+        inputLeft -= m_block.header_size;
+        return lzma_block_decoder(&m_stream, &m_block) == LZMA_OK;
+    }
+
+    ~XzBlockDecoder() override
+    {
+        lzma_end(&m_stream);
+        for (int i = 0; m_filters[i].id != LZMA_VLI_UNKNOWN; ++i) {
+            free(m_filters[i].options);
+        }
+    }
+
+    Status decode(const uchar *&input, size_t &inputLeft, uchar *output, size_t &outputLeft) override
+    {
+        m_stream.next_in = input;
+        m_stream.avail_in = inputLeft;
+        m_stream.next_out = output;
+        m_stream.avail_out = outputLeft;
+
+        const lzma_ret ret = lzma_code(&m_stream, LZMA_RUN);
+
+        input = m_stream.next_in;
+        inputLeft = m_stream.avail_in;
+        outputLeft = m_stream.avail_out;
+
+        switch (ret) {
+        case LZMA_STREAM_END:
+            return StreamEnd;
+        case LZMA_OK:
+        case LZMA_BUF_ERROR:
+            return Ok;
+        default:
+            return Failed;
+        }
+    }
+
+private:
+    lzma_stream m_stream = LZMA_STREAM_INIT;
+    lzma_block m_block = {};
+    // Terminated by LZMA_VLI_UNKNOWN, also if the block header is never decoded.
+    lzma_filter m_filters[LZMA_FILTERS_MAX + 1] = {{LZMA_VLI_UNKNOWN, nullptr}};
+};
+#endif
+
+#if HAVE_ZSTD
+class ZstdDecoder : public ParallelDecompressor::Decoder
+{
+public:
+    bool init()
+    {
+        m_context = ZSTD_createDCtx();
+        return m_context != nullptr;
+    }
+
+    ~ZstdDecoder() override
+    {
+        ZSTD_freeDCtx(m_context);
+    }
+
+    Status decode(const uchar *&input, size_t &inputLeft, uchar *output, size_t &outputLeft) override
+    {
+        ZSTD_inBuffer in = {input, inputLeft, 0};
+        ZSTD_outBuffer out = {output, outputLeft, 0};
+
+        const size_t ret = ZSTD_decompressStream(m_context, &out, &in);
+
+        input += in.pos;
+        inputLeft -= in.pos;
+        outputLeft -= out.pos;
+
+        if (ZSTD_isError(ret)) {
+            return Failed;
+        }
+        // 0 means that the frame has been completely decoded and flushed.
+        return (ret == 0) ? StreamEnd : Ok;
+    }
+
+private:
+    ZSTD_DCtx *m_context = nullptr;
+};
+#endif
+
+std::shared_ptr<ParallelDecompressor::Decoder> createDecoder(ParallelDecompressor::Format format, int check, const uchar *&input, size_t &inputLeft)
+{
+    Q_UNUSED(check)
+    Q_UNUSED(input)
+    Q_UNUSED(inputLeft)
+
+    switch (format) {
+    case ParallelDecompressor::Gzip: {
+        auto decoder = std::make_shared<GzipDecoder>();
+        return decoder->init() ? decoder : nullptr;
+    }
+#if HAVE_BZIP2
+    case ParallelDecompressor::Bzip2: {
+        auto decoder = std::make_shared<Bzip2Decoder>();
+        return decoder->init() ? decoder : nullptr;
+    }
+#endif
+#if HAVE_LZMA
+    case ParallelDecompressor::Xz: {
+        auto decoder = std::make_shared<XzBlockDecoder>();
+        return decoder->init(input, inputLeft, static_cast<lzma_check>(check)) ? decoder : nullptr;
+    }
+#endif
+#if HAVE_ZSTD
+    case ParallelDecompressor::Zstd: {
+        auto decoder = std::make_shared<ZstdDecoder>();
+        return decoder->init() ? decoder : nullptr;
+    }
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+/**
+ * Decodes into @p output until the end of the unit or until @p output holds @p limit bytes.
+ */
+ParallelDecompressor::Decoder::Status
+pump(ParallelDecompressor::Decoder &decoder, ParallelDecompressor::UnitReader &reader, QByteArray &output, qsizetype limit)
+{
+    while (output.size() < limit) {
+        if (!reader.fill()) {
+            return ParallelDecompressor::Decoder::Failed;
+        }
+
+        const qsizetype oldSize = output.size();
+        const qsizetype chunk = std::min(limit - oldSize, ReadChunkSize);
+        output.resize(oldSize + chunk);
+
+        const size_t oldInputLeft = reader.inputLeft;
+        size_t outputLeft = chunk;
+        const auto status = decoder.decode(reader.input, reader.inputLeft, reinterpret_cast<uchar *>(output.data()) + oldSize, outputLeft);
+        output.resize(oldSize + chunk - outputLeft);
+
+        if (status != ParallelDecompressor::Decoder::Ok) {
+            return status;
+        }
+        if (outputLeft == static_cast<size_t>(chunk) && reader.inputLeft == oldInputLeft) {
+            // No progress: the unit is truncated.
+            return ParallelDecompressor::Decoder::Failed;
+        }
+    }
+
+    return ParallelDecompressor::Decoder::Ok;
+}
+
+QByteArray readAt(QFile &file, qint64 offset, qint64 size)
+{
+    return file.seek(offset) ? file.read(size) : QByteArray();
+}
+
+/**
+ * Calls @p find on the whole file, chunk by chunk, and collects the offsets it returns.
+ * Chunks overlap so that magic bytes spanning two chunks are found too.
+ */
+template<typename Find>
+std::vector<qint64> scanFile(QFile &file, qint64 size, Find find)
+{
+    // The magic bytes looked for take up to 10 bytes.
+    const qint64 overlap = 10;
+
+    std::vector<qint64> offsets;
+    for (qint64 base = 0; base < size; base += ScanChunkSize) {
+        const QByteArray chunk = readAt(file, base, ScanChunkSize + overlap);
+        if (chunk.isEmpty()) {
+            return {};
+        }
+        for (qint64 offset : find(reinterpret_cast<const uchar *>(chunk.constData()), chunk.size())) {
+            // Later offsets are found again at the start of the next chunk.
+            if (offset < ScanChunkSize) {
+                offsets.push_back(base + offset);
+            }
+        }
+    }
+    return offsets;
+}
+
+std::vector<qint64> findGzipMembers(const uchar *data, qint64 size)
+{
+    std::vector<qint64> offsets;
+    for (const uchar *p = data; (p = static_cast<const uchar *>(memchr(p, 0x1f, static_cast<size_t>(data + size - p)))) != nullptr; ++p) {
+        const qint64 left = data + size - p;
+        if (left < 10) {
+            break;
+        }
+        // ID1 ID2 CM, no reserved flags, known XFL and OS.
+        if (p[1] == 0x8b && p[2] == 8 && (p[3] & 0xe0) == 0 && (p[8] == 0 || p[8] == 2 || p[8] == 4) && (p[9] <= 13 || p[9] == 255)) {
+            offsets.push_back(p - data);
+        }
+    }
+    return offsets;
+}
+
+std::vector<qint64> findBzip2Streams(const uchar *data, qint64 size)
+{
+    static const uchar blockMagic[] = {0x31, 0x41, 0x59, 0x26, 0x53, 0x59};
+    static const uchar endMagic[] = {0x17, 0x72, 0x45, 0x38, 0x50, 0x90};
+
+    std::vector<qint64> offsets;
+    for (const uchar *p = data; (p = static_cast<const uchar *>(memchr(p, 'B', static_cast<size_t>(data + size - p)))) != nullptr; ++p) {
+        const qint64 left = data + size - p;
+        if (left < 10) {
+            break;
+        }
+        // "BZh", the block size and either the first block or the end of an empty stream.
+        if (p[1] == 'Z' && p[2] == 'h' && p[3] >= '1' && p[3] <= '9' && (!memcmp(p + 4, blockMagic, 6) || !memcmp(p + 4, endMagic, 6))) {
+            offsets.push_back(p - data);
+        }
+    }
+    return offsets;
+}
+
+#if HAVE_LZMA
+bool findXzBlocks(QFile &file, qint64 size, std::vector<qint64> &offsets, std::vector<qint64> &sizes, qint64 &dataEnd, lzma_check &check)
+{
+    // Only a single stream, possibly followed by stream padding, is supported.
+    qint64 end = size;
+    while (end >= 4 && readAt(file, end - 4, 4) == QByteArray(4, '\0')) {
+        end -= 4;
+    }
+    if (end < 2 * LZMA_STREAM_HEADER_SIZE) {
+        return false;
+    }
+
+    const QByteArray headerData = readAt(file, 0, LZMA_STREAM_HEADER_SIZE);
+    const QByteArray footerData = readAt(file, end - LZMA_STREAM_HEADER_SIZE, LZMA_STREAM_HEADER_SIZE);
+    if (headerData.size() != LZMA_STREAM_HEADER_SIZE || footerData.size() != LZMA_STREAM_HEADER_SIZE) {
+        return false;
+    }
+
+    lzma_stream_flags header;
+    lzma_stream_flags footer;
+    if (lzma_stream_header_decode(&header, reinterpret_cast<const uint8_t *>(headerData.constData())) != LZMA_OK
+        || lzma_stream_footer_decode(&footer, reinterpret_cast<const uint8_t *>(footerData.constData())) != LZMA_OK
+        || lzma_stream_flags_compare(&header, &footer) != LZMA_OK) {
+        return false;
+    }
+
+    const qint64 indexStart = end - LZMA_STREAM_HEADER_SIZE - static_cast<qint64>(footer.backward_size);
+    if (indexStart < LZMA_STREAM_HEADER_SIZE) {
+        return false;
+    }
+
+    const QByteArray indexData = readAt(file, indexStart, static_cast<qint64>(footer.backward_size));
+    if (indexData.size() != static_cast<qsizetype>(footer.backward_size)) {
+        return false;
+    }
+
+    lzma_index *index = nullptr;
+    uint64_t memoryLimit = UINT64_MAX;
+    size_t position = 0;
+    if (lzma_index_buffer_decode(&index, &memoryLimit, nullptr, reinterpret_cast<const uint8_t *>(indexData.constData()), &position, indexData.size())
+        != LZMA_OK) {
+        return false;
+    }
+
+    const bool isSingleStream = lzma_index_stream_size(index) == static_cast<lzma_vli>(end);
+    if (isSingleStream) {
+        lzma_index_iter iter;
+        lzma_index_iter_init(&iter, index);
+        while (!lzma_index_iter_next(&iter, LZMA_INDEX_ITER_BLOCK)) {
+            offsets.push_back(static_cast<qint64>(iter.block.compressed_file_offset));
+            sizes.push_back(static_cast<qint64>(iter.block.total_size));
+        }
+    }
+    lzma_index_end(index, nullptr);
+
+    dataEnd = indexStart;
+    check = header.check;
+    return isSingleStream;
+}
+#endif
+
+#if HAVE_ZSTD
+/**
+ * Walks the frames through their headers and block headers, see RFC 8878.
+ */
+bool findZstdFrames(QFile &file, qint64 size, std::vector<qint64> &offsets, std::vector<qint64> &sizes)
+{
+    for (qint64 offset = 0; offset < size;) {
+        const QByteArray header = readAt(file, offset, 8);
+        if (header.size() < 8) {
+            return false;
+        }
+
+        const quint32 magic = qFromLittleEndian<quint32>(header.constData());
+        qint64 frameEnd;
+        if ((magic & 0xfffffff0) == 0x184d2a50) {
+            // Skippable frame: the magic number and the size of its content.
+            frameEnd = offset + 8 + qFromLittleEndian<quint32>(header.constData() + 4);
+        } else if (magic == 0xfd2fb528) {
+            static const int dictionaryIdSizes[] = {0, 1, 2, 4};
+            const uchar descriptor = static_cast<uchar>(header.at(4));
+            const bool isSingleSegment = descriptor & 0x20;
+            const int contentSizeFlag = descriptor >> 6;
+            const int contentSizeSize = (contentSizeFlag == 0) ? (isSingleSegment ? 1 : 0) : (1 << contentSizeFlag);
+
+            qint64 position = offset + 5 + (isSingleSegment ? 0 : 1) + dictionaryIdSizes[descriptor & 3] + contentSizeSize;
+            bool isLastBlock = false;
+            while (!isLastBlock) {
+                const QByteArray blockHeader = readAt(file, position, 3);
+                if (blockHeader.size() < 3) {
+                    return false;
+                }
+                const quint32 value = static_cast<uchar>(blockHeader.at(0)) | static_cast<uchar>(blockHeader.at(1)) << 8
+                    | static_cast<uchar>(blockHeader.at(2)) << 16;
+                isLastBlock = value & 1;
+                const int blockType = (value >> 1) & 3;
+                if (blockType == 3) {
+                    return false;
+                }
+                // An RLE block holds the single byte to be repeated.
+                position += 3 + ((blockType == 1) ? 1 : (value >> 3));
+            }
+            // Optional content checksum.
+            frameEnd = position + ((descriptor & 0x04) ? 4 : 0);
+        } else {
+            return false;
+        }
+
+        if (frameEnd > size) {
+            return false;
+        }
+        offsets.push_back(offset);
+        sizes.push_back(frameEnd - offset);
+        offset = frameEnd;
+    }
+    return true;
+}
+#endif
+}
+
+ParallelDecompressor::ParallelDecompressor(Format format, int threadCount)
+    : m_format(format)
+{
+    m_threadPool.setMaxThreadCount(threadCount);
+    m_maxPendingUnits = static_cast<std::size_t>(threadCount) + 1;
+    m_maxUnitOutput = std::min(MaxBufferedOutput, MaxTotalBufferedOutput / static_cast<qsizetype>(m_maxPendingUnits));
+}
+
+ParallelDecompressor::~ParallelDecompressor()
+{
+    // Results of the running tasks are not needed anymore.
+    m_pendingUnits.clear();
+    m_threadPool.waitForDone();
+}
+
+std::unique_ptr<ParallelDecompressor> ParallelDecompressor::create(const QString &fileName, int threadCount)
+{
+    if (threadCount < 2) {
+        return nullptr;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < 16) {
+        return nullptr;
+    }
+
+    const qint64 size = file.size();
+    const QByteArray magic = file.read(6);
+
+    Format format;
+    if (magic.startsWith("\x1f\x8b")) {
+        format = Gzip;
+#if HAVE_BZIP2
+    } else if (magic.startsWith("BZh")) {
+        format = Bzip2;
+#endif
+#if HAVE_LZMA
+    } else if (magic == QByteArray("\xfd" "7zXZ\0", 6)) {
+        format = Xz;
+#endif
+#if HAVE_ZSTD
+    } else if (magic.startsWith("\x28\xb5\x2f\xfd")) {
+        format = Zstd;
+#endif
+    } else {
+        return nullptr;
+    }
+
+    std::unique_ptr<ParallelDecompressor> decompressor(new ParallelDecompressor(format, threadCount));
+    decompressor->m_fileName = fileName;
+    decompressor->m_dataEnd = size;
+
+    switch (format) {
+    case Gzip:
+        decompressor->m_unitOffsets = scanFile(file, size, findGzipMembers);
+        break;
+    case Bzip2:
+        decompressor->m_unitOffsets = scanFile(file, size, findBzip2Streams);
+        break;
+#if HAVE_LZMA
+    case Xz: {
+        lzma_check check;
+        if (!findXzBlocks(file, size, decompressor->m_unitOffsets, decompressor->m_unitSizes, decompressor->m_dataEnd, check)) {
+            return nullptr;
+        }
+        decompressor->m_check = check;
+        break;
+    }
+#endif
+#if HAVE_ZSTD
+    case Zstd:
+        if (!findZstdFrames(file, size, decompressor->m_unitOffsets, decompressor->m_unitSizes)) {
+            return nullptr;
+        }
+        break;
+#endif
+    default:
+        return nullptr;
+    }
+
+    // A single unit can't be decoded any faster than by libarchive itself.
+    if (decompressor->m_unitOffsets.size() < 2) {
+        return nullptr;
+    }
+
+    // xz blocks follow the stream header, which the block decoders don't need.
+    // All the other formats have their first unit at the start of the file.
+#if HAVE_LZMA
+    const qint64 firstUnitOffset = (format == Xz) ? LZMA_STREAM_HEADER_SIZE : 0;
+#else
+    const qint64 firstUnitOffset = 0;
+#endif
+    decompressor->m_position = decompressor->m_unitOffsets.front();
+    if (decompressor->m_position != firstUnitOffset) {
+        return nullptr;
+    }
+
+    qCDebug(ARK_LOG) << "Decoding" << decompressor->m_unitOffsets.size() << "units of" << fileName << "with" << threadCount << "threads";
+    return decompressor;
+}
+
+ParallelDecompressor::Result
+ParallelDecompressor::decodeUnit(Format format, int check, const QString &fileName, qint64 offset, qint64 end, qsizetype maxOutput)
+{
+    Result result;
+    auto reader = std::make_shared<UnitReader>(fileName, offset, end);
+    if (!reader->fill()) {
+        return result;
+    }
+
+    auto decoder = createDecoder(format, check, reader->input, reader->inputLeft);
+    if (!decoder) {
+        return result;
+    }
+
+    switch (pump(*decoder, *reader, result.data, maxOutput)) {
+    case Decoder::StreamEnd:
+        result.end = reader->position();
+        result.isValid = true;
+        break;
+    case Decoder::Ok:
+        // Too large to be buffered, read() decodes the rest.
+        result.decoder = decoder;
+        result.reader = reader;
+        result.isValid = true;
+        break;
+    case Decoder::Failed:
+        break;
+    }
+
+    return result;
+}
+
+void ParallelDecompressor::scheduleUnits()
+{
+    // Units before the current position were false candidates, their results are not needed.
+    while (!m_pendingUnits.empty() && m_pendingUnits.front().offset < m_position) {
+        m_pendingUnits.pop_front();
+    }
+    while (m_nextUnit < m_unitOffsets.size() && m_unitOffsets[m_nextUnit] < m_position) {
+        ++m_nextUnit;
+    }
+
+    while (m_pendingUnits.size() < m_maxPendingUnits && m_nextUnit < m_unitOffsets.size()) {
+        const qint64 offset = m_unitOffsets[m_nextUnit];
+        const qint64 end = m_unitSizes.empty() ? m_dataEnd : offset + m_unitSizes[m_nextUnit];
+        m_pendingUnits.push_back(
+            {offset, QtConcurrent::run(&m_threadPool, &ParallelDecompressor::decodeUnit, m_format, m_check, m_fileName, offset, end, m_maxUnitOutput)});
+        ++m_nextUnit;
+    }
+}
+
+qint64 ParallelDecompressor::read(const void **buffer)
+{
+    while (true) {
+        if (m_current.decoder) {
+            // Keep decoding a unit that was too large to be buffered.
+            m_buffer.clear();
+            switch (pump(*m_current.decoder, *m_current.reader, m_buffer, ReadChunkSize)) {
+            case Decoder::StreamEnd:
+                m_position = m_current.reader->position();
+                m_current = Result();
+                break;
+            case Decoder::Ok:
+                break;
+            case Decoder::Failed:
+                qCWarning(ARK_LOG) << "Failed to decode data at offset" << m_currentUnitStart;
+                return -1;
+            }
+
+            if (!m_buffer.isEmpty()) {
+                *buffer = m_buffer.constData();
+                return m_buffer.size();
+            }
+            continue;
+        }
+
+        if (m_position >= m_dataEnd || !std::binary_search(m_unitOffsets.cbegin(), m_unitOffsets.cend(), m_position)) {
+            // Like gzip and bzip2, ignore trailing data which is not a new member/stream.
+            return 0;
+        }
+
+        scheduleUnits();
+        Q_ASSERT(!m_pendingUnits.empty() && m_pendingUnits.front().offset == m_position);
+
+        Result result = m_pendingUnits.front().future.result();
+        m_pendingUnits.pop_front();
+        if (!result.isValid) {
+            qCWarning(ARK_LOG) << "Failed to decode data at offset" << m_position;
+            return -1;
+        }
+
+        m_currentUnitStart = m_position;
+        if (!result.decoder) {
+            m_position = result.end;
+        }
+        m_buffer = result.data;
+        m_current = result;
+        m_current.data.clear();
+
+        if (!m_buffer.isEmpty()) {
+            *buffer = m_buffer.constData();
+            return m_buffer.size();
+        }
+    }
+}
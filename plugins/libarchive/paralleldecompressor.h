@@ -0,0 +1,99 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef PARALLELDECOMPRESSOR_H
+#define PARALLELDECOMPRESSOR_H
+
+#include <QByteArray>
+#include <QFuture>
+#include <QString>
+#include <QThreadPool>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+/**
+ * Decompresses a file on several threads, if it is made of independently decodable units:
+ * concatenated gzip members or bzip2 streams (as written by ParallelCompressor, bgzip or pbzip2),
+ * the blocks of a multi-block xz stream (xz -T) or the frames of a multi-frame zstd file.
+ *
+ * Units are decoded concurrently and handed out in order by read(),
+ * which is meant to be used as an archive_read_open() callback.
+ * The file is read rather than mapped, so that it being truncated meanwhile is a decoding error.
+ */
+class ParallelDecompressor
+{
+public:
+    ~ParallelDecompressor();
+
+    /**
+     * @return A decompressor for @p fileName, or nullptr if the file is not made of
+     * at least two independent units that can be decoded by this build.
+     */
+    static std::unique_ptr<ParallelDecompressor> create(const QString &fileName, int threadCount);
+
+    /**
+     * Points @p buffer to the next chunk of decompressed data.
+     *
+     * @return The size of the chunk, 0 at the end of the data or -1 on error.
+     */
+    qint64 read(const void **buffer);
+
+    class Decoder;
+    class UnitReader;
+
+    enum Format {
+        Gzip,
+        Bzip2,
+        Xz,
+        Zstd,
+    };
+
+    struct Result {
+        QByteArray data;
+        // Set if the unit was too large to be buffered and must be decoded further.
+        std::shared_ptr<Decoder> decoder;
+        std::shared_ptr<UnitReader> reader;
+        // Where the unit ends, once it has been completely decoded.
+        qint64 end = 0;
+        bool isValid = false;
+    };
+
+private:
+    ParallelDecompressor(Format format, int threadCount);
+
+    static Result decodeUnit(Format format, int check, const QString &fileName, qint64 offset, qint64 end, qsizetype maxOutput);
+    void scheduleUnits();
+
+    const Format m_format;
+    QString m_fileName;
+    qint64 m_dataEnd = 0;
+    int m_check = 0;
+
+    // Offsets of the units. For gzip and bzip2 these are candidates found by their magic bytes,
+    // so the next unit actually starts where decoding of the previous one stopped.
+    std::vector<qint64> m_unitOffsets;
+    std::vector<qint64> m_unitSizes;
+    std::size_t m_nextUnit = 0;
+
+    QThreadPool m_threadPool;
+    std::size_t m_maxPendingUnits;
+    // What a scheduled unit may buffer before it is left for read() to finish.
+    qsizetype m_maxUnitOutput;
+    struct PendingUnit {
+        qint64 offset;
+        QFuture<Result> future;
+    };
+    std::deque<PendingUnit> m_pendingUnits;
+
+    qint64 m_position = 0;
+    qint64 m_currentUnitStart = 0;
+    Result m_current;
+    QByteArray m_buffer;
+};
+
+#endif // PARALLELDECOMPRESSOR_H
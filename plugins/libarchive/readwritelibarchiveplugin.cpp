@@ -9,17 +9,34 @@
 
 #include "readwritelibarchiveplugin.h"
 #include "ark_debug.h"
+#include "pathlistreader.h"
 
 #include <KLocalizedString>
 #include <KPluginFactory>
 
-#include <QDirIterator>
+#include <QDateTime>
+#include <QDir>
+#include <QHash>
+#include <QSet>
 #include <QThread>
 
 #include <archive_entry.h>
 
+#include <algorithm>
+
+#if HAVE_COPY_FILE_RANGE
+#include <unistd.h>
+#endif
+
 K_PLUGIN_CLASS_WITH_JSON(ReadWriteLibarchivePlugin, "kerfuffle_libarchive.json")
 
+// Largest amount of zero padding after the end-of-archive marker that we accept
+// to overwrite when appending to a tar (the record size used by "tar -b 2048").
+static const qint64 MaxTrailingPadding = 1024 * 1024;
+
+// Number of paths read at once from a file list, and read ahead together.
+static const int FileListBatchSize = 256;
+
 ReadWriteLibarchivePlugin::ReadWriteLibarchivePlugin(QObject *parent, const QVariantList &args)
     : LibarchivePlugin(parent, args)
 {
@@ -38,7 +55,7 @@ bool ReadWriteLibarchivePlugin::addFiles(const QList<Archive::Entry *> &files,
     qCDebug(ARK_LOG) << "Adding" << files.size() << "entries with CompressionOptions" << options;
 
     const bool creatingNewFile = !QFileInfo::exists(filename());
-    const uint totalCount = m_numberOfEntries + numberOfEntriesToAdd;
+    uint totalCount = m_numberOfEntries + numberOfEntriesToAdd;
 
     m_writtenFiles.clear();
 
@@ -46,6 +63,57 @@ bool ReadWriteLibarchivePlugin::addFiles(const QList<Archive::Entry *> &files,
         return false;
     }
 
+    // Recreate destination directory structure.
+    const QString destinationPath = (destination == nullptr) ? QString() : destination->fullPath();
+    if (!options.fileList().isEmpty()) {
+        // Writing the list straight away would replace the existing entries, see canAddFromFileList().
+        if (!creatingNewFile) {
+            qCWarning(ARK_LOG) << "Cannot add the files listed in" << options.fileList() << "to an existing archive";
+            Q_EMIT error(i18n("Files can only be added from a list to a new archive."));
+            return false;
+        }
+        return addFilesFromList(options.fileList(), destinationPath, options);
+    }
+    auto manifest = fileManifest(files, options);
+    if (QThread::currentThread()->isInterruptionRequested()) {
+        return false;
+    }
+
+    if (!creatingNewFile && options.isUpdateMode()) {
+        const uint fileCount = manifest->items().size();
+        manifest = changedFiles(*manifest, destinationPath);
+        if (QThread::currentThread()->isInterruptionRequested()) {
+            return false;
+        }
+        qCDebug(ARK_LOG) << manifest->items().size() << "of" << fileCount << "files are new or changed";
+        if (manifest->items().empty()) {
+            return true;
+        }
+        totalCount = m_numberOfEntries + manifest->items().size();
+
+        // Reading the existing entries consumed the reader.
+        if (!initializeReader()) {
+            return false;
+        }
+    }
+    if (options.sortByType()) {
+        manifest = manifest->sortedByType();
+    }
+    const QStringList paths = pathsToAdd(*manifest);
+
+    if (!creatingNewFile && isUncompressedTar()) {
+        // A plain tar can be extended by overwriting its end-of-archive marker,
+        // as long as none of the existing entries has to be replaced.
+        qint64 endOffset = -1;
+        if (findAppendOffset(destinationPath, paths, endOffset)) {
+            return appendFiles(*manifest, destinationPath, endOffset, paths.size());
+        }
+        // Looking for the end of the archive consumed the reader.
+        if (!initializeReader()) {
+            return false;
+        }
+    }
+
     if (!initializeWriter(creatingNewFile, options)) {
         return false;
     }
@@ -53,48 +121,21 @@ bool ReadWriteLibarchivePlugin::addFiles(const QList<Archive::Entry *> &files,
     // First write the new files.
     qCDebug(ARK_LOG) << "Writing new entries";
     uint addedEntries = 0;
-    // Recreate destination directory structure.
-    const QString destinationPath = (destination == nullptr) ? QString() : destination->fullPath();
-
-    for (Archive::Entry *selectedFile : files) {
+    m_readAhead = std::make_unique<FileReadAhead>(paths);
+    for (int i = 0; i < paths.size(); ++i) {
         if (QThread::currentThread()->isInterruptionRequested()) {
             break;
         }
 
-        if (!writeFile(selectedFile->fullPath(), destinationPath)) {
+        if (!writeFile(paths.at(i), destinationPath, manifest->items().at(i))) {
+            m_readAhead.reset();
             finish(false);
             return false;
         }
         addedEntries++;
         Q_EMIT progress(float(addedEntries) / float(totalCount));
-
-        // For directories, write all subfiles/folders.
-        const QString &fullPath = selectedFile->fullPath();
-        if (QFileInfo(fullPath).isDir()) {
-            QDirIterator it(fullPath, QDir::AllEntries | QDir::Readable | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
-
-            while (!QThread::currentThread()->isInterruptionRequested() && it.hasNext()) {
-                QString path = it.next();
-
-                if ((it.fileName() == QLatin1String("..")) || (it.fileName() == QLatin1Char('.'))) {
-                    continue;
-                }
-
-                const bool isRealDir = it.fileInfo().isDir() && !it.fileInfo().isSymLink();
-
-                if (isRealDir) {
-                    path.append(QLatin1Char('/'));
-                }
-
-                if (!writeFile(path, destinationPath)) {
-                    finish(false);
-                    return false;
-                }
-                addedEntries++;
-                Q_EMIT progress(float(addedEntries) / float(totalCount));
-            }
-        }
     }
+    m_readAhead.reset();
     qCDebug(ARK_LOG) << "Added" << addedEntries << "new entries to archive";
 
     bool isSuccessful = true;
@@ -110,8 +151,7 @@ bool ReadWriteLibarchivePlugin::addFiles(const QList<Archive::Entry *> &files,
         }
     }
 
-    finish(isSuccessful);
-    return isSuccessful;
+    return finish(isSuccessful);
 }
 
 bool ReadWriteLibarchivePlugin::moveFiles(const QList<Archive::Entry *> &files, Archive::Entry *destination, const CompressionOptions &options)
@@ -124,15 +164,31 @@ bool ReadWriteLibarchivePlugin::moveFiles(const QList<Archive::Entry *> &files,
         return false;
     }
 
+    m_filesPaths = entryFullPaths(files);
+    m_entriesWithoutChildren = entriesWithoutChildren(files).count();
+    m_destination = destination;
+
+    // Moving only changes the headers of the moved entries, which can be rewritten on their own in a tar.
+    // Other formats (e.g. 7z, whose headers are compressed together at the end) are written anew.
+    if (isTar()) {
+        const QMap<QString, QString> pathMap = movedPaths();
+        bool isSuccessful = false;
+        if (isUncompressedTar() ? renameInPlace(pathMap, isSuccessful) : renameInStream(pathMap, isSuccessful)) {
+            return isSuccessful;
+        }
+
+        qCDebug(ARK_LOG) << "Could not rename the entries in their headers, rewriting the archive";
+        if (!initializeReader()) {
+            return false;
+        }
+    }
+
     if (!initializeWriter()) {
         return false;
     }
 
     // Copy old elements from previous archive to new archive.
     uint movedEntries = 0;
-    m_filesPaths = entryFullPaths(files);
-    m_entriesWithoutChildren = entriesWithoutChildren(files).count();
-    m_destination = destination;
     const bool isSuccessful = processOldEntries(movedEntries, Move, m_numberOfEntries);
     if (isSuccessful) {
         qCDebug(ARK_LOG) << "Moved" << movedEntries << "entries within archive";
@@ -140,8 +196,7 @@ bool ReadWriteLibarchivePlugin::moveFiles(const QList<Archive::Entry *> &files,
         qCDebug(ARK_LOG) << "Moving entries failed";
     }
 
-    finish(isSuccessful);
-    return isSuccessful;
+    return finish(isSuccessful);
 }
 
 bool ReadWriteLibarchivePlugin::copyFiles(const QList<Archive::Entry *> &files, Archive::Entry *destination, const CompressionOptions &options)
@@ -169,8 +224,7 @@ bool ReadWriteLibarchivePlugin::copyFiles(const QList<Archive::Entry *> &files,
         qCDebug(ARK_LOG) << "Copying entries failed";
     }
 
-    finish(isSuccessful);
-    return isSuccessful;
+    return finish(isSuccessful);
 }
 
 bool ReadWriteLibarchivePlugin::deleteFiles(const QList<Archive::Entry *> &files)
@@ -195,13 +249,98 @@ bool ReadWriteLibarchivePlugin::deleteFiles(const QList<Archive::Entry *> &files
         qCDebug(ARK_LOG) << "Removing entries failed";
     }
 
-    finish(isSuccessful);
-    return isSuccessful;
+    return finish(isSuccessful);
+}
+
+bool ReadWriteLibarchivePlugin::canAddFromFileList() const
+{
+    // The entries of an existing archive are copied after the new ones, skipping the replaced ones,
+    // which needs all the new paths. The 7z writer keeps all the headers until the end anyway.
+    return !QFileInfo::exists(filename()) && mimetype().name() != QLatin1String("application/x-7z-compressed");
+}
+
+bool ReadWriteLibarchivePlugin::addFilesFromList(const QString &listFile, const QString &destination, const CompressionOptions &options)
+{
+    PathListReader reader(listFile);
+    if (!reader.open()) {
+        qCWarning(ARK_LOG) << "Could not open" << listFile << reader.errorString();
+        Q_EMIT error(xi18nc("@info", "Could not read the list of files <filename>%1</filename>.", listFile));
+        return false;
+    }
+
+    if (!initializeWriter(true, options)) {
+        return false;
+    }
+
+    m_isAddingFromList = true;
+    uint addedEntries = 0;
+    bool isSuccessful = true;
+    bool isAtEnd = false;
+    QStringList paths;
+    std::vector<FileManifest::Item> items;
+    QString path;
+    const QDir workDir = QDir::current();
+    while (isSuccessful && !isAtEnd && !QThread::currentThread()->isInterruptionRequested()) {
+        paths.clear();
+        items.clear();
+        while (paths.size() < FileListBatchSize && reader.next(path)) {
+            const QFileInfo info(path);
+            FileManifest::Item item;
+            item.path = workDir.relativeFilePath(path);
+            item.isSymLink = info.isSymLink();
+            item.isDir = info.isDir() && !item.isSymLink;
+            if (!item.isSymLink && !info.exists()) {
+                Q_EMIT error(xi18nc("@info", "The file <filename>%1</filename> does not exist.", path));
+                isSuccessful = false;
+                break;
+            }
+            // Like the files found in directories, sockets, fifos and devices are left out.
+            if (!item.isSymLink && !item.isDir && !info.isFile()) {
+                qCDebug(ARK_LOG) << "Skipping special file" << path;
+                continue;
+            }
+            const QString cleanPath = QDir::cleanPath(item.path);
+            if (cleanPath == QLatin1String("..") || cleanPath.startsWith(QLatin1String("../"))) {
+                Q_EMIT error(xi18nc("@info", "The file <filename>%1</filename> is outside of the current folder.", path));
+                isSuccessful = false;
+                break;
+            }
+            paths << item.path;
+            items.push_back(std::move(item));
+        }
+        isAtEnd = isSuccessful && paths.size() < FileListBatchSize;
+
+        m_readAhead = std::make_unique<FileReadAhead>(paths);
+        for (size_t i = 0; isSuccessful && i < items.size(); ++i) {
+            if (QThread::currentThread()->isInterruptionRequested()) {
+                break;
+            }
+            isSuccessful = writeFile(items[i].path, destination, items[i]);
+            if (isSuccessful) {
+                addedEntries++;
+            }
+        }
+        m_readAhead.reset();
+
+        if (reader.progress() >= 0) {
+            Q_EMIT progress(reader.progress());
+        }
+    }
+    m_isAddingFromList = false;
+
+    if (isSuccessful) {
+        qCDebug(ARK_LOG) << "Added" << addedEntries << "entries from" << listFile;
+    }
+    return finish(isSuccessful);
 }
 
 void ReadWriteLibarchivePlugin::initializeWriterFormat()
 {
-    if (filename().endsWith(QLatin1String("7z"), Qt::CaseInsensitive)) {
+    if (m_writeRawStream) {
+        // The tar stream is written as the data of a single raw entry, and passed on as soon as it's written.
+        archive_write_set_format_raw(m_archiveWriter.data());
+        archive_write_set_bytes_per_block(m_archiveWriter.data(), 0);
+    } else if (filename().endsWith(QLatin1String("7z"), Qt::CaseInsensitive)) {
         archive_write_set_format_7zip(m_archiveWriter.data());
     } else {
         // TAR case:
@@ -210,8 +349,17 @@ void ReadWriteLibarchivePlugin::initializeWriterFormat()
     }
 }
 
+// Hands the tar stream written by libarchive over to the ParallelCompressor.
+static la_ssize_t writeToCompressor(struct archive *, void *clientData, const void *buffer, size_t length)
+{
+    auto compressor = static_cast<ParallelCompressor *>(clientData);
+    return compressor->write(static_cast<const char *>(buffer), length) ? static_cast<la_ssize_t>(length) : -1;
+}
+
 bool ReadWriteLibarchivePlugin::initializeWriter(const bool creatingNewFile, const CompressionOptions &options)
 {
+    m_parallelCompressor.reset();
+
     m_tempFile.setFileName(filename());
     if (!m_tempFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered)) {
         Q_EMIT error(i18nc("@info", "Failed to create a temporary file for writing data."));
@@ -236,7 +384,16 @@ bool ReadWriteLibarchivePlugin::initializeWriter(const bool creatingNewFile, con
         }
     }
 
-    if (archive_write_open_fd(m_archiveWriter.data(), m_tempFile.handle()) != ARCHIVE_OK) {
+    // Untouched entries of a plain tar are copied verbatim by processOldEntries(),
+    // so the writer must not hold back any data in its block buffer.
+    m_copyRawEntries = !creatingNewFile && isUncompressedTar();
+    if (m_copyRawEntries) {
+        archive_write_set_bytes_per_block(m_archiveWriter.data(), 0);
+    }
+
+    const int ret = m_parallelCompressor ? archive_write_open(m_archiveWriter.data(), m_parallelCompressor.get(), nullptr, writeToCompressor, nullptr)
+                                         : archive_write_open_fd(m_archiveWriter.data(), m_tempFile.handle());
+    if (ret != ARCHIVE_OK) {
         Q_EMIT error(i18nc("@info", "Could not open the archive for writing entries."));
         return false;
     }
@@ -250,10 +407,10 @@ bool ReadWriteLibarchivePlugin::initializeWriterFilters()
     bool requiresExecutable = false;
     switch (archive_filter_code(m_archiveReader.data(), 0)) {
     case ARCHIVE_FILTER_GZIP:
-        ret = archive_write_add_filter_gzip(m_archiveWriter.data());
+        ret = addParallelFilter(ParallelCompressor::Gzip, -1, defaultThreadCount()) ? ARCHIVE_OK : archive_write_add_filter_gzip(m_archiveWriter.data());
         break;
     case ARCHIVE_FILTER_BZIP2:
-        ret = archive_write_add_filter_bzip2(m_archiveWriter.data());
+        ret = addParallelFilter(ParallelCompressor::Bzip2, -1, defaultThreadCount()) ? ARCHIVE_OK : archive_write_add_filter_bzip2(m_archiveWriter.data());
         break;
     case ARCHIVE_FILTER_XZ:
         ret = archive_write_add_filter_xz(m_archiveWriter.data());
@@ -302,17 +459,26 @@ bool ReadWriteLibarchivePlugin::initializeNewFileCompressionOptions(const Compre
 {
     int ret;
     bool requiresExecutable = false;
-    const auto threads = std::to_string(std::max(1u, static_cast<unsigned>(std::thread::hardware_concurrency() * 0.8)));
+    const int threadCount = options.isThreadCountSet() ? options.threadCount() : defaultThreadCount();
+    const auto threads = std::to_string(threadCount);
     const bool is7zFile = filename().endsWith(QLatin1String("7z"), Qt::CaseInsensitive);
 
     if (is7zFile) {
         // 7zip format doesn't need any filter to be set.
     } else if (filename().endsWith(QLatin1String("gz"), Qt::CaseInsensitive)) {
         qCDebug(ARK_LOG) << "Detected gzip compression for new file";
-        ret = archive_write_add_filter_gzip(m_archiveWriter.data());
+        if (addParallelFilter(ParallelCompressor::Gzip, options.compressionLevel(), threadCount)) {
+            ret = ARCHIVE_OK;
+        } else {
+            ret = archive_write_add_filter_gzip(m_archiveWriter.data());
+        }
     } else if (filename().endsWith(QLatin1String("bz2"), Qt::CaseInsensitive)) {
         qCDebug(ARK_LOG) << "Detected bzip2 compression for new file";
-        ret = archive_write_add_filter_bzip2(m_archiveWriter.data());
+        if (addParallelFilter(ParallelCompressor::Bzip2, options.compressionLevel(), threadCount)) {
+            ret = ARCHIVE_OK;
+        } else {
+            ret = archive_write_add_filter_bzip2(m_archiveWriter.data());
+        }
     } else if (filename().endsWith(QLatin1String("xz"), Qt::CaseInsensitive)) {
         qCDebug(ARK_LOG) << "Detected xz compression for new file";
         ret = archive_write_add_filter_xz(m_archiveWriter.data());
@@ -379,7 +545,8 @@ bool ReadWriteLibarchivePlugin::initializeNewFileCompressionOptions(const Compre
     }
 
     // Set compression level if passed in CompressionOptions.
-    if (options.isCompressionLevelSet()) {
+    // The ParallelCompressor has already been given the level.
+    if (options.isCompressionLevelSet() && !m_parallelCompressor) {
         qCDebug(ARK_LOG) << "Using compression level:" << options.compressionLevel();
         // 7zip supports the compression level as format option (it doesn't have any filter).
         if (is7zFile) {
@@ -404,8 +571,25 @@ bool ReadWriteLibarchivePlugin::initializeNewFileCompressionOptions(const Compre
     return true;
 }
 
-void ReadWriteLibarchivePlugin::finish(const bool isSuccessful)
+bool ReadWriteLibarchivePlugin::addParallelFilter(ParallelCompressor::Format format, int level, int threadCount)
 {
+    if (threadCount < 2 || !ParallelCompressor::isSupported(format)) {
+        return false;
+    }
+
+    // libarchive writes a plain tar stream, which is compressed by the ParallelCompressor.
+    if (archive_write_add_filter_none(m_archiveWriter.data()) != ARCHIVE_OK) {
+        return false;
+    }
+
+    qCDebug(ARK_LOG) << "Compressing with" << threadCount << "threads";
+    m_parallelCompressor = std::make_unique<ParallelCompressor>(format, level, threadCount, &m_tempFile);
+    return true;
+}
+
+bool ReadWriteLibarchivePlugin::finish(const bool isSuccessful)
+{
+    bool isWritten = isSuccessful;
     if (!isSuccessful || QThread::currentThread()->isInterruptionRequested()) {
         archive_write_fail(m_archiveWriter.data());
         m_tempFile.cancelWriting();
@@ -415,8 +599,26 @@ void ReadWriteLibarchivePlugin::finish(const bool isSuccessful)
         // TODO: We need to abstract this code better so that we only deal with one
         // object that manages both QSaveFile and ArchiveWriter.
         archive_write_close(m_archiveWriter.data());
-        m_tempFile.commit();
+        if (m_parallelCompressor && !m_parallelCompressor->close()) {
+            Q_EMIT error(i18nc("@info", "Could not compress entry, operation aborted."));
+            m_tempFile.cancelWriting();
+            isWritten = false;
+        } else {
+            m_tempFile.commit();
+        }
     }
+
+    m_parallelCompressor.reset();
+    return isWritten;
+}
+
+void ReadWriteLibarchivePlugin::discardTempFile()
+{
+    archive_write_fail(m_archiveWriter.data());
+    m_parallelCompressor.reset();
+    // Once writing is cancelled, commit() only closes the temporary file and removes it.
+    m_tempFile.cancelWriting();
+    m_tempFile.commit();
 }
 
 bool ReadWriteLibarchivePlugin::processOldEntries(uint &entriesCounter, OperationMode mode, uint totalCount)
@@ -428,25 +630,50 @@ bool ReadWriteLibarchivePlugin::processOldEntries(uint &entriesCounter, Operatio
     // Create a map that contains old path as key and new path as value.
     QMap<QString, QString> pathMap;
     if (mode == Move || mode == Copy) {
-        m_filesPaths.sort();
-        QStringList resultList = entryPathsFromDestination(m_filesPaths, m_destination, m_entriesWithoutChildren);
-        const int listSize = m_filesPaths.count();
-        Q_ASSERT(listSize == resultList.count());
-        for (int i = 0; i < listSize; ++i) {
-            pathMap.insert(m_filesPaths.at(i), resultList.at(i));
-        }
+        pathMap = movedPaths();
+    }
+
+    // Consecutive untouched entries of a plain tar are collected into a single
+    // byte range of the old archive, which is copied as is once an entry needs to be rewritten.
+    QFile rawSource(filename());
+    if (m_copyRawEntries && !rawSource.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        qCWarning(ARK_LOG) << "Could not open" << filename() << "for copying entries, rewriting them instead";
+        m_copyRawEntries = false;
+    }
+    if (m_copyRawEntries && archive_write_finish_entry(m_archiveWriter.data()) != ARCHIVE_OK) {
+        // Pads the last entry written by addFiles().
+        return false;
     }
+    qint64 rangeStart = -1;
+    const auto flushRange = [&](qint64 rangeEnd) {
+        if (rangeStart < 0) {
+            return true;
+        }
+        const qint64 start = rangeStart;
+        rangeStart = -1;
+        return copyRawData(rawSource, start, rangeEnd - start);
+    };
 
     struct archive_entry *entry;
-    while (!QThread::currentThread()->isInterruptionRequested() && archive_read_next_header(m_archiveReader.data(), &entry) == ARCHIVE_OK) {
+    int result = ARCHIVE_OK;
+    while (!QThread::currentThread()->isInterruptionRequested() && (result = archive_read_next_header(m_archiveReader.data(), &entry)) == ARCHIVE_OK) {
         const QString file = QFile::decodeName(archive_entry_pathname(entry));
+        const qint64 headerPosition = archive_read_header_position(m_archiveReader.data());
+        bool isModified = false;
 
         if (mode == Move || mode == Copy) {
             const QString newPathname = pathMap.value(file);
             if (!newPathname.isEmpty()) {
+                if (!flushRange(headerPosition)) {
+                    return false;
+                }
+
                 if (mode == Copy) {
-                    // Write the old entry.
-                    if (!writeEntry(entry)) {
+                    if (m_copyRawEntries) {
+                        // The original is copied verbatim after the new entry.
+                        rangeStart = headerPosition;
+                    } else if (!writeEntry(entry)) {
+                        // Write the old entry.
                         return false;
                     }
                 } else {
@@ -455,12 +682,16 @@ bool ReadWriteLibarchivePlugin::processOldEntries(uint &entriesCounter, Operatio
 
                 entriesCounter++;
                 iteratedEntries--;
+                isModified = true;
 
                 // Change entry path.
                 archive_entry_set_pathname(entry, newPathname.toUtf8().constData());
                 emitEntryFromArchiveEntry(entry);
             }
         } else if (m_filesPaths.contains(file)) {
+            if (!flushRange(headerPosition)) {
+                return false;
+            }
             archive_read_data_skip(m_archiveReader.data());
             switch (mode) {
             case Delete:
@@ -484,21 +715,42 @@ bool ReadWriteLibarchivePlugin::processOldEntries(uint &entriesCounter, Operatio
         }
 
         // Write old entries.
-        if (writeEntry(entry)) {
-            if (mode == Add) {
-                entriesCounter++;
-            } else if (mode == Move || mode == Copy) {
-                iteratedEntries++;
-            } else if (mode == Delete) {
-                iteratedEntries++;
+        if (m_copyRawEntries && !isModified) {
+            if (rangeStart < 0) {
+                rangeStart = headerPosition;
             }
-        } else {
+        } else if (!writeEntry(entry)) {
             return false;
+        } else if (m_copyRawEntries && archive_write_finish_entry(m_archiveWriter.data()) != ARCHIVE_OK) {
+            return false;
+        }
+
+        if (mode == Add) {
+            entriesCounter++;
+        } else if (mode == Move || mode == Copy) {
+            iteratedEntries++;
+        } else if (mode == Delete) {
+            iteratedEntries++;
         }
         Q_EMIT progress(float(newEntries + entriesCounter + iteratedEntries) / float(totalCount));
     }
 
-    return !QThread::currentThread()->isInterruptionRequested();
+    if (QThread::currentThread()->isInterruptionRequested()) {
+        return false;
+    }
+
+    if (m_copyRawEntries) {
+        // After the last header the reader points at the end-of-archive marker,
+        // which archive_write_close() writes anew.
+        if (result != ARCHIVE_EOF) {
+            qCWarning(ARK_LOG) << "Could not read the next header:" << archive_error_string(m_archiveReader.data());
+            Q_EMIT error(i18nc("@info", "Archive corrupted or insufficient permissions."));
+            return false;
+        }
+        return flushRange(archive_read_header_position(m_archiveReader.data()));
+    }
+
+    return true;
 }
 
 bool ReadWriteLibarchivePlugin::writeEntry(struct archive_entry *entry)
@@ -523,14 +775,15 @@ bool ReadWriteLibarchivePlugin::writeEntry(struct archive_entry *entry)
     return true;
 }
 
-// TODO: if we merge this with copyData(), we can pass more data
+// TODO: if we merge this with copyFileData(), we can pass more data
 //       such as an fd to archive_read_disk_entry_from_file()
-bool ReadWriteLibarchivePlugin::writeFile(const QString &relativeName, const QString &destination)
+bool ReadWriteLibarchivePlugin::writeFile(const QString &relativeName, const QString &destination, const FileManifest::Item &item)
 {
     const QString absoluteFilename = QFileInfo(relativeName).absoluteFilePath();
     const QString destinationFilename = destination + relativeName;
+    const FileReadAhead::File prefetched = m_readAhead ? m_readAhead->take(relativeName) : FileReadAhead::File();
 
-    struct stat st;
+    struct stat st = item.st;
 #ifndef Q_OS_WIN
     // #253059: Even if we use archive_read_disk_entry_from_file,
     //          libarchive may have been compiled without HAVE_LSTAT,
@@ -538,7 +791,10 @@ bool ReadWriteLibarchivePlugin::writeFile(const QString &relativeName, const QSt
     //          which case stat() will be called. To avoid this, we
     //          call lstat() ourselves.
 
-    lstat(QFile::encodeName(absoluteFilename).constData(), &st); // krazy:exclude=syscalls
+    // The manifest usually has the result of lstat() already.
+    if (!item.hasStat) {
+        lstat(QFile::encodeName(absoluteFilename).constData(), &st); // krazy:exclude=syscalls
+    }
 #endif
 
     struct archive_entry *entry = archive_entry_new();
@@ -550,7 +806,7 @@ bool ReadWriteLibarchivePlugin::writeFile(const QString &relativeName, const QSt
     if (returnCode == ARCHIVE_OK) {
         // If the whole archive is extracted and the total filesize is
         // available, we use partial progress.
-        copyData(absoluteFilename, m_archiveWriter.data(), false);
+        copyFileData(absoluteFilename, prefetched);
     } else {
         qCCritical(ARK_LOG) << "Writing header failed with error code " << returnCode;
         qCCritical(ARK_LOG) << "Error while writing..." << archive_error_string(m_archiveWriter.data())
@@ -568,14 +824,463 @@ bool ReadWriteLibarchivePlugin::writeFile(const QString &relativeName, const QSt
         return false;
     }
 
-    m_writtenFiles.push_back(destinationFilename);
-
-    emitEntryFromArchiveEntry(entry);
+    if (!m_isAddingFromList) {
+        m_writtenFiles.push_back(destinationFilename);
+        emitEntryFromArchiveEntry(entry);
+    }
 
     archive_entry_free(entry);
 
     return true;
 }
 
+void ReadWriteLibarchivePlugin::copyFileData(const QString &filename, const FileReadAhead::File &prefetched)
+{
+    if (prefetched.isValid && !prefetched.head.isEmpty()) {
+        if (archive_write_data(m_archiveWriter.data(), prefetched.head.constData(), static_cast<size_t>(prefetched.head.size())) < 0) {
+            qCCritical(ARK_LOG) << "Error while writing" << filename << ":" << archive_error_string(m_archiveWriter.data())
+                                << "(error no =" << archive_errno(m_archiveWriter.data()) << ')';
+            return;
+        }
+    }
+    if (prefetched.isValid && prefetched.isComplete) {
+        return;
+    }
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+        return;
+    }
+
+    qint64 offset = prefetched.isValid ? prefetched.head.size() : 0;
+    if (offset > 0 && !file.seek(offset)) {
+        return;
+    }
+
+    // Large reads, with the kernel reading the next ones while the current one is compressed.
+    m_copyBuffer.resize(1024 * 1024);
+    while (!QThread::currentThread()->isInterruptionRequested()) {
+        FileReadAhead::adviseReadAhead(file.handle(), offset + m_copyBuffer.size());
+
+        const qint64 readBytes = file.read(m_copyBuffer.data(), m_copyBuffer.size());
+        if (readBytes <= 0) {
+            break;
+        }
+        offset += readBytes;
+
+        archive_write_data(m_archiveWriter.data(), m_copyBuffer.constData(), static_cast<size_t>(readBytes));
+        if (archive_errno(m_archiveWriter.data()) != ARCHIVE_OK) {
+            qCCritical(ARK_LOG) << "Error while writing" << filename << ":" << archive_error_string(m_archiveWriter.data())
+                                << "(error no =" << archive_errno(m_archiveWriter.data()) << ')';
+            return;
+        }
+    }
+}
+
+QSharedPointer<const FileManifest> ReadWriteLibarchivePlugin::fileManifest(const QList<Archive::Entry *> &files, const CompressionOptions &options) const
+{
+    const QStringList roots = entryFullPaths(files);
+    const auto manifest = options.fileManifest();
+    if (manifest && manifest->roots() == roots) {
+        return manifest;
+    }
+    return FileManifest::scan(roots);
+}
+
+QStringList ReadWriteLibarchivePlugin::pathsToAdd(const FileManifest &manifest)
+{
+    QStringList paths;
+    paths.reserve(manifest.items().size());
+    for (const auto &item : manifest.items()) {
+        if (!item.isTopLevel && item.isDir) {
+            paths << item.path + QLatin1Char('/');
+        } else {
+            paths << item.path;
+        }
+    }
+    return paths;
+}
+
+QSharedPointer<const FileManifest> ReadWriteLibarchivePlugin::changedFiles(const FileManifest &manifest, const QString &destination)
+{
+    struct Stamp {
+        qint64 size;
+        qint64 mtime;
+        uint type;
+    };
+    QHash<QString, Stamp> stamps;
+
+    struct archive_entry *entry;
+    while (!QThread::currentThread()->isInterruptionRequested() && archive_read_next_header(m_archiveReader.data(), &entry) == ARCHIVE_OK) {
+        QString file = QFile::decodeName(archive_entry_pathname(entry));
+        if (file.endsWith(QLatin1Char('/'))) {
+            file.chop(1);
+        }
+        stamps.insert(file, {archive_entry_size(entry), archive_entry_mtime(entry), archive_entry_filetype(entry)});
+    }
+
+    return manifest.filtered([&stamps, &destination](const FileManifest::Item &item) {
+        QString file = destination + item.path;
+        if (file.endsWith(QLatin1Char('/'))) {
+            file.chop(1);
+        }
+        const auto it = stamps.constFind(file);
+        if (it == stamps.constEnd()) {
+            return true;
+        }
+
+        // Directories are kept as they are, their mtime changes with their contents anyway.
+        if (item.isDir) {
+            return it->type != AE_IFDIR;
+        }
+
+        const qint64 mtime = item.hasStat ? qint64(item.st.st_mtime) : QFileInfo(item.path).lastModified().toSecsSinceEpoch();
+        if (it->mtime != mtime) {
+            return true;
+        }
+        // The size of a symlink entry is 0, not the length of its target.
+        if (item.isSymLink) {
+            return it->type != AE_IFLNK;
+        }
+        return it->type != AE_IFREG || it->size != item.size;
+    });
+}
+
+bool ReadWriteLibarchivePlugin::isTar() const
+{
+    const QString mimeTypeName = mimetype().name();
+    return mimetype().inherits(QStringLiteral("application/x-tar")) || mimeTypeName.endsWith(QLatin1String("-compressed-tar"))
+        || mimeTypeName == QLatin1String("application/x-tarz");
+}
+
+bool ReadWriteLibarchivePlugin::isUncompressedTar() const
+{
+    return mimetype().inherits(QStringLiteral("application/x-tar")) && archive_filter_code(m_archiveReader.data(), 0) == ARCHIVE_FILTER_NONE;
+}
+
+bool ReadWriteLibarchivePlugin::findAppendOffset(const QString &destination, const QStringList &paths, qint64 &endOffset)
+{
+    QSet<QString> newPaths;
+    for (const QString &path : paths) {
+        newPaths.insert(destination + path);
+    }
+
+    struct archive_entry *entry;
+    int result = ARCHIVE_OK;
+    while (!QThread::currentThread()->isInterruptionRequested() && (result = archive_read_next_header(m_archiveReader.data(), &entry)) == ARCHIVE_OK) {
+        const QString file = QFile::decodeName(archive_entry_pathname(entry));
+        if (newPaths.contains(file)) {
+            qCDebug(ARK_LOG) << file << "would be overwritten, the archive needs to be rewritten";
+            return false;
+        }
+    }
+
+    if (QThread::currentThread()->isInterruptionRequested() || result != ARCHIVE_EOF) {
+        return false;
+    }
+
+    // The reader stops at the end-of-archive marker. Anything after it must be
+    // the zero padding of the last record, which we are allowed to overwrite.
+    endOffset = archive_read_header_position(m_archiveReader.data());
+
+    QFile archive(filename());
+    if (!archive.open(QIODevice::ReadOnly) || !archive.seek(endOffset) || archive.size() - endOffset > MaxTrailingPadding) {
+        return false;
+    }
+    const QByteArray padding = archive.readAll();
+    return std::all_of(padding.cbegin(), padding.cend(), [](char c) {
+        return c == '\0';
+    });
+}
+
+bool ReadWriteLibarchivePlugin::appendFiles(const FileManifest &manifest, const QString &destination, qint64 endOffset, uint totalCount)
+{
+    const QStringList paths = pathsToAdd(manifest);
+    qCDebug(ARK_LOG) << "Appending" << paths.size() << "entries at offset" << endOffset;
+
+    QFile archive(filename());
+    if (!archive.open(QIODevice::ReadWrite | QIODevice::Unbuffered) || !archive.seek(endOffset)) {
+        Q_EMIT error(i18nc("@info", "Could not open the archive for writing entries."));
+        return false;
+    }
+
+    m_archiveWriter.reset(archive_write_new());
+    if (!(m_archiveWriter.data())) {
+        Q_EMIT error(i18n("The archive writer could not be initialized."));
+        return false;
+    }
+
+    archive_write_set_format_pax_restricted(m_archiveWriter.data());
+    archive_write_add_filter_none(m_archiveWriter.data());
+    // Don't pad the last record, the file is truncated right after the end-of-archive marker.
+    archive_write_set_bytes_in_last_block(m_archiveWriter.data(), 1);
+
+    if (archive_write_open_fd(m_archiveWriter.data(), archive.handle()) != ARCHIVE_OK) {
+        Q_EMIT error(i18nc("@info", "Could not open the archive for writing entries."));
+        return false;
+    }
+
+    uint addedEntries = 0;
+    bool isSuccessful = true;
+    m_readAhead = std::make_unique<FileReadAhead>(paths);
+    for (int i = 0; i < paths.size(); ++i) {
+        if (QThread::currentThread()->isInterruptionRequested()) {
+            break;
+        }
+
+        if (!writeFile(paths.at(i), destination, manifest.items().at(i))) {
+            isSuccessful = false;
+            break;
+        }
+        addedEntries++;
+        Q_EMIT progress(float(addedEntries) / float(totalCount));
+    }
+    m_readAhead.reset();
+
+    if (isSuccessful && !QThread::currentThread()->isInterruptionRequested() && archive_write_close(m_archiveWriter.data()) == ARCHIVE_OK) {
+        archive.resize(endOffset + archive_filter_bytes(m_archiveWriter.data(), -1));
+        qCDebug(ARK_LOG) << "Added" << addedEntries << "new entries to archive";
+        return true;
+    }
+
+    // Drop whatever was appended and restore the old end-of-archive marker.
+    archive_write_fail(m_archiveWriter.data());
+    archive.resize(endOffset);
+    archive.seek(endOffset);
+    archive.write(QByteArray(2 * 512, '\0'));
+    qCDebug(ARK_LOG) << "Appending entries failed";
+    return false;
+}
+
+bool ReadWriteLibarchivePlugin::copyRawData(QFile &source, qint64 offset, qint64 length)
+{
+    const int destination = m_tempFile.handle();
+
+#if HAVE_COPY_FILE_RANGE
+    // Lets the kernel copy (or reflink) the data without passing it through userspace.
+    // Fall back to read()/write() if the filesystems don't support it.
+    loff_t sourceOffset = offset;
+    while (length > 0) {
+        const ssize_t copied = copy_file_range(source.handle(), &sourceOffset, destination, nullptr, static_cast<size_t>(length), 0);
+        if (copied <= 0) {
+            break;
+        }
+        length -= copied;
+    }
+    offset = sourceOffset;
+#endif
+
+    if (length > 0 && !source.seek(offset)) {
+        qCCritical(ARK_LOG) << "Could not seek in" << source.fileName();
+        Q_EMIT error(i18nc("@info", "Could not compress entry, operation aborted."));
+        return false;
+    }
+
+    QByteArray buffer(qMin<qint64>(length, 1024 * 1024), Qt::Uninitialized);
+    while (length > 0) {
+        const qint64 bytesRead = source.read(buffer.data(), qMin<qint64>(length, buffer.size()));
+        if (bytesRead <= 0) {
+            qCCritical(ARK_LOG) << "Could not read from" << source.fileName() << source.errorString();
+            Q_EMIT error(i18nc("@info", "Could not compress entry, operation aborted."));
+            return false;
+        }
+
+        // Write straight to the descriptor, libarchive writes to it as well.
+        for (qint64 written = 0; written < bytesRead;) {
+            const auto ret = QT_WRITE(destination, buffer.constData() + written, bytesRead - written);
+            if (ret < 0) {
+                qCCritical(ARK_LOG) << "Could not write to" << m_tempFile.fileName();
+                Q_EMIT error(i18nc("@info", "Could not compress entry, operation aborted."));
+                return false;
+            }
+            written += ret;
+        }
+        length -= bytesRead;
+    }
+
+    return true;
+}
+
+QMap<QString, QString> ReadWriteLibarchivePlugin::movedPaths()
+{
+    QMap<QString, QString> pathMap;
+    m_filesPaths.sort();
+    const QStringList resultList = entryPathsFromDestination(m_filesPaths, m_destination, m_entriesWithoutChildren);
+    const int listSize = m_filesPaths.count();
+    Q_ASSERT(listSize == resultList.count());
+    for (int i = 0; i < listSize; ++i) {
+        pathMap.insert(m_filesPaths.at(i), resultList.at(i));
+    }
+    return pathMap;
+}
+
+bool ReadWriteLibarchivePlugin::renameInPlace(const QMap<QString, QString> &pathMap, bool &isSuccessful)
+{
+    QFile file(filename());
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+        qCWarning(ARK_LOG) << "Could not open" << filename() << "for writing:" << file.errorString();
+        return false;
+    }
+
+    // Only the headers are read, the data of the entries is seeked over.
+    TarRenamer renamer(pathMap, TarRenamer::Sink());
+    char block[512];
+    while (!renamer.finish()) {
+        if (QThread::currentThread()->isInterruptionRequested()) {
+            isSuccessful = false;
+            return true;
+        }
+        if (const qint64 dataLeft = renamer.dataLeft()) {
+            const qint64 length = std::min(dataLeft, file.size() - file.pos());
+            if (length <= 0 || !file.seek(file.pos() + length)) {
+                break;
+            }
+            renamer.skip(length);
+            continue;
+        }
+        const qint64 bytesRead = file.read(block, sizeof(block));
+        if (bytesRead <= 0 || !renamer.write(block, bytesRead)) {
+            break;
+        }
+        Q_EMIT progress(float(file.pos()) / float(file.size()));
+    }
+
+    if (!renamer.finish()) {
+        return false;
+    }
+    const auto &patches = renamer.patches();
+    const bool fitsInPlace = std::all_of(patches.cbegin(), patches.cend(), [](const TarRenamer::Patch &patch) {
+        return patch.headers.size() == patch.length;
+    });
+    if (!fitsInPlace) {
+        qCDebug(ARK_LOG) << "The new headers don't have the same size as the old ones";
+        return false;
+    }
+
+    for (const auto &patch : patches) {
+        if (!file.seek(patch.offset) || file.write(patch.headers) != patch.length) {
+            qCCritical(ARK_LOG) << "Could not write to" << filename() << file.errorString();
+            Q_EMIT error(i18nc("@info", "Could not write the new names of the entries to the archive."));
+            isSuccessful = false;
+            return true;
+        }
+    }
+
+    qCDebug(ARK_LOG) << "Moved" << renamer.renamedEntries().size() << "entries within archive, rewriting" << patches.size() << "headers";
+    emitRenamedEntries(renamer.renamedEntries());
+    isSuccessful = true;
+    return true;
+}
+
+bool ReadWriteLibarchivePlugin::renameInStream(const QMap<QString, QString> &pathMap, bool &isSuccessful)
+{
+    // Reads the decompressed tar stream as it is, without parsing it.
+    ArchiveRead reader(archive_read_new());
+    if (!reader.data() || archive_read_support_filter_all(reader.data()) != ARCHIVE_OK || archive_read_support_format_raw(reader.data()) != ARCHIVE_OK) {
+        return false;
+    }
+    struct archive_entry *entry;
+    if (archive_read_open_filename(reader.data(), QFile::encodeName(filename()).constData(), 10240) != ARCHIVE_OK
+        || archive_read_next_header(reader.data(), &entry) != ARCHIVE_OK) {
+        qCWarning(ARK_LOG) << "Could not read the tar stream:" << archive_error_string(reader.data());
+        return false;
+    }
+
+    // The writer compresses the stream with the same filter, using the ParallelCompressor if possible.
+    m_writeRawStream = true;
+    const bool isWriterInitialized = initializeWriter();
+    m_writeRawStream = false;
+    if (!isWriterInitialized) {
+        isSuccessful = false;
+        return true;
+    }
+
+    struct archive_entry *rawEntry = archive_entry_new();
+    archive_entry_set_pathname(rawEntry, "data");
+    archive_entry_set_filetype(rawEntry, AE_IFREG);
+    const bool isHeaderWritten = (archive_write_header(m_archiveWriter.data(), rawEntry) == ARCHIVE_OK);
+    archive_entry_free(rawEntry);
+
+    TarRenamer renamer(pathMap, [this](const char *data, qint64 size) {
+        return archive_write_data(m_archiveWriter.data(), data, static_cast<size_t>(size)) == size;
+    });
+
+    const qint64 compressedSize = QFileInfo(filename()).size();
+    int result = isHeaderWritten ? ARCHIVE_OK : ARCHIVE_FATAL;
+    while (result == ARCHIVE_OK && !QThread::currentThread()->isInterruptionRequested()) {
+        const void *buffer;
+        size_t size;
+        la_int64_t offset;
+        result = archive_read_data_block(reader.data(), &buffer, &size, &offset);
+        if (result == ARCHIVE_OK && !renamer.write(static_cast<const char *>(buffer), static_cast<qint64>(size))) {
+            result = ARCHIVE_FATAL;
+        }
+        Q_EMIT progress(float(archive_filter_bytes(reader.data(), -1)) / float(compressedSize));
+    }
+
+    if (QThread::currentThread()->isInterruptionRequested()) {
+        discardTempFile();
+        isSuccessful = false;
+        return true;
+    }
+
+    if (result != ARCHIVE_EOF || !renamer.finish()) {
+        qCDebug(ARK_LOG) << "Could not rename the entries in the tar stream:" << archive_error_string(reader.data());
+        discardTempFile();
+        return false;
+    }
+
+    isSuccessful = finish(true);
+    if (isSuccessful) {
+        qCDebug(ARK_LOG) << "Moved" << renamer.renamedEntries().size() << "entries within archive";
+        emitRenamedEntries(renamer.renamedEntries());
+    }
+    return true;
+}
+
+void ReadWriteLibarchivePlugin::emitRenamedEntries(const std::vector<TarRenamer::RenamedEntry> &entries)
+{
+    for (const auto &renamed : entries) {
+        Q_EMIT entryRemoved(renamed.oldPath);
+
+        struct archive_entry *entry = archive_entry_new();
+        archive_entry_set_pathname(entry, renamed.newPath.toUtf8().constData());
+        switch (renamed.type) {
+        case '5':
+            archive_entry_set_filetype(entry, AE_IFDIR);
+            break;
+        case '2':
+            archive_entry_set_filetype(entry, AE_IFLNK);
+            archive_entry_set_symlink(entry, renamed.linkTarget.constData());
+            break;
+        case '3':
+            archive_entry_set_filetype(entry, AE_IFCHR);
+            break;
+        case '4':
+            archive_entry_set_filetype(entry, AE_IFBLK);
+            break;
+        case '6':
+            archive_entry_set_filetype(entry, AE_IFIFO);
+            break;
+        default:
+            archive_entry_set_filetype(entry, AE_IFREG);
+            if (renamed.type == '1') {
+                archive_entry_set_hardlink(entry, renamed.linkTarget.constData());
+            }
+            break;
+        }
+        archive_entry_set_perm(entry, renamed.mode & 07777);
+        archive_entry_set_uid(entry, renamed.uid);
+        archive_entry_set_gid(entry, renamed.gid);
+        archive_entry_set_uname(entry, renamed.owner.constData());
+        archive_entry_set_gname(entry, renamed.group.constData());
+        archive_entry_set_size(entry, renamed.size);
+        archive_entry_set_mtime(entry, renamed.mtime, 0);
+
+        emitEntryFromArchiveEntry(entry);
+        archive_entry_free(entry);
+    }
+}
+
 #include "moc_readwritelibarchiveplugin.cpp"
 #include "readwritelibarchiveplugin.moc"
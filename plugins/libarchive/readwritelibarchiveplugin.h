@@ -9,11 +9,18 @@
 #ifndef READWRITELIBARCHIVEPLUGIN_H
 #define READWRITELIBARCHIVEPLUGIN_H
 
+#include "filemanifest.h"
+#include "filereadahead.h"
 #include "libarchiveplugin.h"
+#include "parallelcompressor.h"
+#include "tarrenamer.h"
 
+#include <QFile>
 #include <QSaveFile>
 #include <QStringList>
 
+#include <memory>
+
 using namespace Kerfuffle;
 
 class ReadWriteLibarchivePlugin : public LibarchivePlugin
@@ -31,15 +38,28 @@ public:
     bool moveFiles(const QList<Archive::Entry *> &files, Archive::Entry *destination, const CompressionOptions &options) override;
     bool copyFiles(const QList<Archive::Entry *> &files, Archive::Entry *destination, const CompressionOptions &options) override;
     bool deleteFiles(const QList<Archive::Entry *> &files) override;
+    bool canAddFromFileList() const override;
 
 protected:
     void initializeWriterFormat();
     bool initializeWriter(const bool creatingNewFile = false, const CompressionOptions &options = CompressionOptions());
     bool initializeWriterFilters();
     bool initializeNewFileCompressionOptions(const CompressionOptions &options);
-    void finish(const bool isSuccessful);
+
+    /**
+     * Closes the writer and commits the archive, unless @p isSuccessful is false.
+     *
+     * @return bool indicating whether the operation was successful.
+     */
+    bool finish(const bool isSuccessful);
 
 private:
+    /**
+     * Drops what was written so far: the temporary file is closed and removed,
+     * and the archive is left untouched.
+     */
+    void discardTempFile();
+
     /**
      * Processes all the existing entries and does manipulations to them
      * based on the OperationMode (Add/Move/Copy/Delete).
@@ -58,14 +78,114 @@ private:
     bool writeEntry(struct archive_entry *entry);
 
     /**
-     * Writes entry from physical disk.
+     * Writes entry from physical disk, using the stat data of @p item if it has any.
+     *
+     * @return bool indicating whether the operation was successful.
+     */
+    bool writeFile(const QString &relativeName, const QString &destination, const FileManifest::Item &item);
+
+    /**
+     * Creates the archive with the files listed in @p listFile, which is read
+     * in batches while they are added.
+     *
+     * @return bool indicating whether the operation was successful.
+     */
+    bool addFilesFromList(const QString &listFile, const QString &destination, const CompressionOptions &options);
+
+    /**
+     * Writes the data of @p filename, starting with what has been read ahead.
+     */
+    void copyFileData(const QString &filename, const FileReadAhead::File &prefetched);
+
+    /**
+     * Compresses the tar stream with a ParallelCompressor instead of a libarchive filter.
+     *
+     * @return bool indicating whether the ParallelCompressor will be used.
+     */
+    bool addParallelFilter(ParallelCompressor::Format format, int level, int threadCount);
+
+    /**
+     * @return The manifest of @p files passed in @p options by AddJob, or a new one
+     *         if there is none or it was made for other files.
+     */
+    QSharedPointer<const FileManifest> fileManifest(const QList<Archive::Entry *> &files, const CompressionOptions &options) const;
+
+    /**
+     * @return The paths of the items of @p manifest, directories below the top level
+     *         with a trailing slash.
+     */
+    static QStringList pathsToAdd(const FileManifest &manifest);
+
+    /**
+     * Reads the headers of the archive and leaves out of @p manifest the files whose
+     * entry under @p destination has the same type, size and modification time.
+     *
+     * @return The new and changed files of @p manifest.
+     */
+    QSharedPointer<const FileManifest> changedFiles(const FileManifest &manifest, const QString &destination);
+
+    /**
+     * @return Whether the archive is a tar, compressed or not, according to its mime type.
+     */
+    bool isTar() const;
+
+    /**
+     * @return Whether the archive being read is a tar without any compression filter.
+     */
+    bool isUncompressedTar() const;
+
+    /**
+     * Reads all the headers of the archive to find the offset of the end-of-archive marker.
+     *
+     * @return bool indicating whether @p paths can be appended at @p endOffset,
+     * i.e. no existing entry would be overwritten and only zero padding follows the marker.
+     */
+    bool findAppendOffset(const QString &destination, const QStringList &paths, qint64 &endOffset);
+
+    /**
+     * Appends new entries to an uncompressed tar in place, starting at @p endOffset.
      *
      * @return bool indicating whether the operation was successful.
      */
-    bool writeFile(const QString &relativeName, const QString &destination);
+    bool appendFiles(const FileManifest &manifest, const QString &destination, qint64 endOffset, uint totalCount);
+
+    /**
+     * @return The old paths of the entries being moved or copied, and their new paths.
+     */
+    QMap<QString, QString> movedPaths();
+
+    /**
+     * Renames the entries of an uncompressed tar by overwriting their headers in the
+     * archive itself, which is only possible if the new headers have the same size.
+     *
+     * @return bool indicating whether the entries could be renamed this way.
+     *         If not, nothing has been written and the archive has to be rewritten.
+     */
+    bool renameInPlace(const QMap<QString, QString> &pathMap, bool &isSuccessful);
+
+    /**
+     * Renames the entries of a compressed tar by decompressing it and compressing
+     * the tar stream again, with only the headers of the renamed entries changed.
+     *
+     * @return bool indicating whether the entries could be renamed this way.
+     *         If not, the archive has to be rewritten entry by entry.
+     */
+    bool renameInStream(const QMap<QString, QString> &pathMap, bool &isSuccessful);
+
+    void emitRenamedEntries(const std::vector<TarRenamer::RenamedEntry> &entries);
+
+    /**
+     * Copies @p length bytes at @p offset of @p source verbatim to the temporary file.
+     *
+     * @return bool indicating whether the operation was successful.
+     */
+    bool copyRawData(QFile &source, qint64 offset, qint64 length);
 
     QSaveFile m_tempFile;
     ArchiveWrite m_archiveWriter;
+    std::unique_ptr<ParallelCompressor> m_parallelCompressor;
+    std::unique_ptr<FileReadAhead> m_readAhead;
+    QByteArray m_copyBuffer;
 
     // New added files by addFiles methods. It's assigned to m_filesPaths
     // and then is used by processOldEntries method (in Add mode) for skipping already written entries.
@@ -75,6 +195,15 @@ private:
     QStringList m_filesPaths;
     int m_entriesWithoutChildren = 0;
     const Archive::Entry *m_destination = nullptr;
+
+    // Whether processOldEntries copies untouched entries byte by byte instead of rewriting them.
+    bool m_copyRawEntries = false;
+
+    // Entries added from a file list are neither remembered nor reported, the list can be arbitrarily long.
+    bool m_isAddingFromList = false;
+
+    // Whether the writer is opened for a tar stream re-emitted by renameInStream().
+    bool m_writeRawStream = false;
 };
 
 #endif // READWRITELIBARCHIVEPLUGIN_H
@@ -0,0 +1,493 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#include "tarrenamer.h"
+#include "ark_debug.h"
+
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace
+{
+const int BlockSize = 512;
+
+// Offsets and lengths of the ustar header fields.
+const int NameOffset = 0, NameLength = 100;
+const int ModeOffset = 100, ModeLength = 8;
+const int UidOffset = 108, UidLength = 8;
+const int GidOffset = 116, GidLength = 8;
+const int SizeOffset = 124, SizeLength = 12;
+const int MtimeOffset = 136, MtimeLength = 12;
+const int ChecksumOffset = 148, ChecksumLength = 8;
+const int TypeOffset = 156;
+const int LinkOffset = 157, LinkLength = 100;
+const int MagicOffset = 257;
+const int UnameOffset = 265, UnameLength = 32;
+const int GnameOffset = 297, GnameLength = 32;
+const int PrefixOffset = 345, PrefixLength = 155;
+// Set in old GNU sparse headers which are followed by more sparse map blocks.
+const int GnuIsExtendedOffset = 482;
+
+qint64 paddedSize(qint64 size)
+{
+    return (size + BlockSize - 1) / BlockSize * BlockSize;
+}
+
+QByteArray field(const char *block, int offset, int length)
+{
+    const char *start = block + offset;
+    return QByteArray(start, std::find(start, start + length, '\0') - start);
+}
+
+void setField(char *block, int offset, int length, const QByteArray &value)
+{
+    memset(block + offset, 0, length);
+    memcpy(block + offset, value.constData(), std::min<qsizetype>(value.size(), length));
+}
+
+/**
+ * Parses an octal number, or a base-256 one as written by GNU tar for large values.
+ *
+ * @return The value, or -1 if it is negative or too large.
+ */
+qint64 parseNumber(const char *block, int offset, int length)
+{
+    const auto bytes = reinterpret_cast<const uchar *>(block + offset);
+    if (bytes[0] & 0x80) {
+        if (bytes[0] & 0x40) {
+            return -1;
+        }
+        qint64 value = bytes[0] & 0x3f;
+        for (int i = 1; i < length; ++i) {
+            if (value > (std::numeric_limits<qint64>::max() >> 8)) {
+                return -1;
+            }
+            value = (value << 8) | bytes[i];
+        }
+        return value;
+    }
+
+    int i = 0;
+    while (i < length && bytes[i] == ' ') {
+        ++i;
+    }
+    qint64 value = 0;
+    for (; i < length && bytes[i] >= '0' && bytes[i] <= '7'; ++i) {
+        if (value > (std::numeric_limits<qint64>::max() >> 3)) {
+            return -1;
+        }
+        value = value * 8 + (bytes[i] - '0');
+    }
+    return value;
+}
+
+void setOctal(char *block, int offset, int length, qint64 value)
+{
+    const QByteArray digits = QByteArray::number(value, 8).rightJustified(length - 1, '0');
+    setField(block, offset, length, digits);
+}
+
+qint64 checksum(const char *block)
+{
+    qint64 sum = 0;
+    for (int i = 0; i < BlockSize; ++i) {
+        const bool isChecksumField = i >= ChecksumOffset && i < ChecksumOffset + ChecksumLength;
+        sum += isChecksumField ? ' ' : static_cast<uchar>(block[i]);
+    }
+    return sum;
+}
+
+bool hasValidChecksum(const char *block)
+{
+    qint64 signedSum = 0;
+    for (int i = 0; i < BlockSize; ++i) {
+        const bool isChecksumField = i >= ChecksumOffset && i < ChecksumOffset + ChecksumLength;
+        signedSum += isChecksumField ? ' ' : static_cast<signed char>(block[i]);
+    }
+    // Some old tar implementations computed the sum with signed chars.
+    const qint64 stored = parseNumber(block, ChecksumOffset, ChecksumLength);
+    return stored == checksum(block) || stored == signedSum;
+}
+
+void updateChecksum(char *block)
+{
+    const QByteArray digits = QByteArray::number(checksum(block), 8).rightJustified(6, '0');
+    memcpy(block + ChecksumOffset, digits.constData(), 6);
+    block[ChecksumOffset + 6] = '\0';
+    block[ChecksumOffset + 7] = ' ';
+}
+
+bool isZeroBlock(const char *block)
+{
+    return std::all_of(block, block + BlockSize, [](char c) {
+        return c == '\0';
+    });
+}
+
+bool isPosixUstar(const char *block)
+{
+    return memcmp(block + MagicOffset, "ustar\0", 6) == 0;
+}
+
+bool isAscii(const QByteArray &name)
+{
+    return std::all_of(name.cbegin(), name.cend(), [](char c) {
+        return static_cast<uchar>(c) < 0x80;
+    });
+}
+
+// Entry types whose size field doesn't count any data following the header.
+bool hasData(char type)
+{
+    return !(type == '2' || type == '3' || type == '4' || type == '5' || type == '6');
+}
+
+QByteArray paxRecord(const QByteArray &key, const QByteArray &value)
+{
+    // The length of a record includes the digits of the length itself.
+    const qsizetype rest = key.size() + value.size() + 3;
+    qsizetype length = rest + QByteArray::number(rest).size();
+    if (QByteArray::number(length).size() + rest != length) {
+        length = rest + QByteArray::number(length).size();
+    }
+    return QByteArray::number(length) + ' ' + key + '=' + value + '\n';
+}
+
+/**
+ * Calls @p function with the key and value of every record in @p data.
+ *
+ * @return Whether @p data consists of valid records.
+ */
+template<typename Function>
+bool forEachPaxRecord(const QByteArray &data, Function function)
+{
+    qsizetype pos = 0;
+    while (pos < data.size() && data.at(pos) != '\0') {
+        const qsizetype space = data.indexOf(' ', pos);
+        bool ok = false;
+        const qsizetype length = space < 0 ? 0 : data.mid(pos, space - pos).toLongLong(&ok);
+        if (!ok || length <= 0 || pos + length > data.size() || data.at(pos + length - 1) != '\n') {
+            return false;
+        }
+        const QByteArray record = data.mid(space + 1, pos + length - space - 2);
+        const qsizetype equals = record.indexOf('=');
+        if (equals < 0) {
+            return false;
+        }
+        function(record.left(equals), record.mid(equals + 1), pos, length);
+        pos += length;
+    }
+    return true;
+}
+
+/**
+ * Builds an extension header of @p type with @p data.
+ */
+QByteArray extensionHeader(const char *entryHeader, char type, const QByteArray &data)
+{
+    QByteArray extension(BlockSize, '\0');
+    char *block = extension.data();
+    setField(block, NameOffset, NameLength, type == 'x' ? QByteArrayLiteral("./PaxHeaders/entry") : QByteArrayLiteral("././@LongLink"));
+    setOctal(block, ModeOffset, ModeLength, 0644);
+    memcpy(block + UidOffset, entryHeader + UidOffset, UidLength);
+    memcpy(block + GidOffset, entryHeader + GidOffset, GidLength);
+    setOctal(block, SizeOffset, SizeLength, data.size());
+    memcpy(block + MtimeOffset, entryHeader + MtimeOffset, MtimeLength);
+    block[TypeOffset] = type;
+    memcpy(block + MagicOffset, entryHeader + MagicOffset, 8);
+    if (type == 'x') {
+        memcpy(block + MagicOffset, "ustar\0" "00", 8);
+    }
+    updateChecksum(block);
+
+    extension += data;
+    extension.resize(BlockSize + paddedSize(data.size()), '\0');
+    return extension;
+}
+}
+
+TarRenamer::TarRenamer(const QMap<QString, QString> &pathMap, const Sink &sink)
+    : m_pathMap(pathMap)
+    , m_sink(sink)
+{
+    m_block.reserve(BlockSize);
+}
+
+bool TarRenamer::write(const char *data, qint64 size)
+{
+    while (!m_hasFailed && size > 0) {
+        qint64 length;
+        if (m_block.isEmpty() && (m_dataLeft > 0 || m_isAtEnd)) {
+            // Entry data, or whatever follows the end of the archive.
+            length = m_isAtEnd ? size : std::min(size, m_dataLeft);
+            if (!output(data, length)) {
+                return false;
+            }
+            m_offset += length;
+            if (!m_isAtEnd) {
+                m_dataLeft -= length;
+            }
+        } else {
+            length = std::min<qint64>(size, BlockSize - m_block.size());
+            m_block.append(data, length);
+            if (m_block.size() == BlockSize) {
+                if (!processBlock(m_block.constData())) {
+                    m_hasFailed = true;
+                    return false;
+                }
+                m_offset += BlockSize;
+                m_block.clear();
+            }
+        }
+        data += length;
+        size -= length;
+    }
+    return !m_hasFailed;
+}
+
+qint64 TarRenamer::dataLeft() const
+{
+    return m_block.isEmpty() ? m_dataLeft : 0;
+}
+
+void TarRenamer::skip(qint64 size)
+{
+    Q_ASSERT(size <= dataLeft());
+    m_dataLeft -= size;
+    m_offset += size;
+}
+
+bool TarRenamer::finish() const
+{
+    return !m_hasFailed && m_isAtEnd && m_block.isEmpty() && m_renamedPaths.size() == m_pathMap.size();
+}
+
+const std::vector<TarRenamer::RenamedEntry> &TarRenamer::renamedEntries() const
+{
+    return m_renamedEntries;
+}
+
+const std::vector<TarRenamer::Patch> &TarRenamer::patches() const
+{
+    return m_patches;
+}
+
+bool TarRenamer::output(const char *data, qint64 size)
+{
+    if (m_sink && !m_sink(data, size)) {
+        m_hasFailed = true;
+        return false;
+    }
+    return true;
+}
+
+bool TarRenamer::processBlock(const char *block)
+{
+    if (m_isAtEnd) {
+        return output(block, BlockSize);
+    }
+    if (m_extensionLeft > 0) {
+        m_extensions.append(block, BlockSize);
+        m_extensionLeft -= BlockSize;
+        return true;
+    }
+    return processHeader(block);
+}
+
+bool TarRenamer::processHeader(const char *block)
+{
+    if (isZeroBlock(block)) {
+        if (!m_extensions.isEmpty()) {
+            qCWarning(ARK_LOG) << "Extension header without entry at offset" << m_offset;
+            return false;
+        }
+        // The end-of-archive marker, everything after it is passed through.
+        m_isAtEnd = true;
+        return output(block, BlockSize);
+    }
+
+    if (!hasValidChecksum(block)) {
+        qCWarning(ARK_LOG) << "Invalid tar header checksum at offset" << m_offset;
+        return false;
+    }
+
+    const char type = block[TypeOffset];
+    const qint64 size = parseNumber(block, SizeOffset, SizeLength);
+    if (size < 0) {
+        return false;
+    }
+
+    if (type == 'x' || type == 'L' || type == 'K') {
+        if (m_extensions.isEmpty()) {
+            m_extensionsOffset = m_offset;
+        }
+        m_extensions.append(block, BlockSize);
+        m_extensionLeft = paddedSize(size);
+        return true;
+    }
+    if (type == 'S' && block[GnuIsExtendedOffset]) {
+        qCDebug(ARK_LOG) << "Old GNU sparse entries are not supported";
+        return false;
+    }
+
+    RenamedEntry entry;
+    entry.type = type;
+    entry.mode = static_cast<uint>(parseNumber(block, ModeOffset, ModeLength));
+    entry.uid = parseNumber(block, UidOffset, UidLength);
+    entry.gid = parseNumber(block, GidOffset, GidLength);
+    entry.size = size;
+    entry.mtime = parseNumber(block, MtimeOffset, MtimeLength);
+    entry.owner = field(block, UnameOffset, UnameLength);
+    entry.group = field(block, GnameOffset, GnameLength);
+    entry.linkTarget = field(block, LinkOffset, LinkLength);
+
+    QByteArray name = field(block, NameOffset, NameLength);
+    const QByteArray prefix = field(block, PrefixOffset, PrefixLength);
+    if (isPosixUstar(block) && !prefix.isEmpty()) {
+        name = prefix + '/' + name;
+    }
+    QString path = QFile::decodeName(name);
+
+    // Extension headers override the fields of the header they precede,
+    // a pax path takes precedence over a GNU long name like it does in libarchive.
+    qsizetype paxExtension = -1;
+    qsizetype longNameExtension = -1;
+    int paxExtensions = 0;
+    int longNameExtensions = 0;
+    QString paxPath;
+    QString longName;
+    for (qsizetype pos = 0; pos < m_extensions.size();) {
+        const char *extension = m_extensions.constData() + pos;
+        const qint64 dataSize = parseNumber(extension, SizeOffset, SizeLength);
+        const QByteArray data = m_extensions.mid(pos + BlockSize, dataSize);
+        switch (extension[TypeOffset]) {
+        case 'x': {
+            paxExtension = pos;
+            ++paxExtensions;
+            const bool isValid = forEachPaxRecord(data, [&](const QByteArray &key, const QByteArray &value, qsizetype, qsizetype) {
+                if (key == "path") {
+                    paxPath = QString::fromUtf8(value);
+                } else if (key == "linkpath") {
+                    entry.linkTarget = value;
+                } else if (key == "size") {
+                    entry.size = value.toLongLong();
+                } else if (key == "mtime") {
+                    entry.mtime = value.left(value.indexOf('.')).toLongLong();
+                } else if (key == "uname") {
+                    entry.owner = value;
+                } else if (key == "gname") {
+                    entry.group = value;
+                } else if (key == "uid") {
+                    entry.uid = value.toLongLong();
+                } else if (key == "gid") {
+                    entry.gid = value.toLongLong();
+                }
+            });
+            if (!isValid) {
+                qCWarning(ARK_LOG) << "Invalid pax header at offset" << m_extensionsOffset;
+                return false;
+            }
+            break;
+        }
+        case 'L':
+            longNameExtension = pos;
+            ++longNameExtensions;
+            longName = QFile::decodeName(field(data.constData(), 0, data.size()));
+            break;
+        case 'K':
+            entry.linkTarget = field(data.constData(), 0, data.size());
+            break;
+        }
+        pos += BlockSize + paddedSize(dataSize);
+    }
+    if (!paxPath.isEmpty()) {
+        path = paxPath;
+    } else if (!longName.isEmpty()) {
+        path = longName;
+    }
+
+    m_dataLeft = hasData(type) ? paddedSize(entry.size) : 0;
+
+    const auto it = m_pathMap.constFind(path);
+    if (it == m_pathMap.constEnd()) {
+        const bool isWritten = output(m_extensions.constData(), m_extensions.size()) && output(block, BlockSize);
+        m_extensions.clear();
+        return isWritten;
+    }
+
+    if (paxExtensions > 1 || longNameExtensions > 1) {
+        // Only one header of each kind is rewritten, an older one left behind could still carry the old name.
+        qCDebug(ARK_LOG) << "Several extension headers for" << path << "at offset" << m_extensionsOffset;
+        return false;
+    }
+
+    const QByteArray newName = it.value().toUtf8();
+    const qint64 offset = m_extensions.isEmpty() ? m_offset : m_extensionsOffset;
+    const qint64 length = m_extensions.size() + BlockSize;
+
+    QByteArray header(block, BlockSize);
+    QByteArray extensions;
+    if (longNameExtension >= 0 || paxExtension >= 0) {
+        // Rewrite the extension carrying the name, keep the other ones as they are.
+        for (qsizetype pos = 0; pos < m_extensions.size();) {
+            const char *extension = m_extensions.constData() + pos;
+            const qint64 dataSize = parseNumber(extension, SizeOffset, SizeLength);
+            const qint64 extensionLength = BlockSize + paddedSize(dataSize);
+            const QByteArray data = m_extensions.mid(pos + BlockSize, dataSize);
+
+            if (pos == longNameExtension) {
+                extensions += extensionHeader(extension, 'L', newName + '\0');
+            } else if (pos == paxExtension && (!paxPath.isEmpty() || longNameExtension < 0)) {
+                // Next to a long name header, the pax header only gets a path if it already had one.
+                QByteArray records;
+                forEachPaxRecord(data, [&](const QByteArray &key, const QByteArray &, qsizetype recordPos, qsizetype recordLength) {
+                    if (key == "path") {
+                        records += paxRecord(key, newName);
+                    } else {
+                        records += data.mid(recordPos, recordLength);
+                    }
+                });
+                if (paxPath.isEmpty()) {
+                    records += paxRecord("path", newName);
+                }
+                QByteArray rewritten = extensionHeader(header.constData(), 'x', records);
+                // Keep the original name of the pax header.
+                memcpy(rewritten.data(), extension, NameLength);
+                updateChecksum(rewritten.data());
+                extensions += rewritten;
+            } else {
+                extensions += m_extensions.mid(pos, extensionLength);
+            }
+            pos += extensionLength;
+        }
+    } else {
+        extensions = m_extensions;
+        if (newName.size() > NameLength || !isAscii(newName)) {
+            extensions += extensionHeader(header.constData(), 'x', paxRecord("path", newName));
+        }
+    }
+
+    // The name in the header itself is only a fallback if there is an extension.
+    setField(header.data(), NameOffset, NameLength, newName);
+    if (isPosixUstar(header.constData())) {
+        setField(header.data(), PrefixOffset, PrefixLength, QByteArray());
+    }
+    updateChecksum(header.data());
+
+    const QByteArray headers = extensions + header;
+    m_patches.push_back({offset, length, headers});
+    m_extensions.clear();
+
+    entry.oldPath = path;
+    entry.newPath = it.value();
+    m_renamedPaths.insert(path);
+    m_renamedEntries.push_back(entry);
+
+    return output(headers.constData(), headers.size());
+}
@@ -0,0 +1,117 @@
+/*
+    SPDX-FileCopyrightText: 2026 Ark Developers <kde-utils-devel@kde.org>
+
+    SPDX-License-Identifier: BSD-2-Clause
+*/
+
+#ifndef TARRENAMER_H
+#define TARRENAMER_H
+
+#include <QByteArray>
+#include <QMap>
+#include <QSet>
+#include <QString>
+
+#include <functional>
+#include <vector>
+
+/**
+ * Renames entries of a tar stream by rewriting only their headers.
+ * The data of the entries, and the headers of the other entries, are passed
+ * through as they are.
+ *
+ * This is used to rename entries of compressed tarballs without parsing and
+ * writing every entry again, and to patch the headers of a plain tar in place.
+ *
+ * ustar, pax and GNU headers are understood. Anything else (e.g. old GNU sparse
+ * files) makes the renamer fail, in which case the caller falls back to
+ * rewriting the archive with libarchive.
+ */
+class TarRenamer
+{
+public:
+    using Sink = std::function<bool(const char *data, qint64 size)>;
+
+    struct RenamedEntry {
+        QString oldPath;
+        QString newPath;
+        char type = '0';
+        uint mode = 0;
+        qint64 uid = 0;
+        qint64 gid = 0;
+        qint64 size = 0;
+        qint64 mtime = 0;
+        QByteArray owner;
+        QByteArray group;
+        QByteArray linkTarget;
+    };
+
+    /**
+     * The headers of a renamed entry, as found at @p offset of the input
+     * and as they are written to the output.
+     */
+    struct Patch {
+        qint64 offset;
+        qint64 length;
+        QByteArray headers;
+    };
+
+    /**
+     * @param pathMap The old paths of the entries to rename, and their new paths.
+     * @param sink Receives the output stream. If empty, nothing is written
+     *             and the renamer only collects the patches.
+     */
+    TarRenamer(const QMap<QString, QString> &pathMap, const Sink &sink);
+
+    /**
+     * Processes the next @p size bytes of the input stream.
+     *
+     * @return Whether the data could be processed and written to the sink.
+     */
+    bool write(const char *data, qint64 size);
+
+    /**
+     * @return The number of bytes of entry data that follow in the input and
+     *         don't need to be looked at. Only meaningful without a sink.
+     */
+    qint64 dataLeft() const;
+
+    /**
+     * Skips @p size bytes of entry data, which must not exceed dataLeft().
+     */
+    void skip(qint64 size);
+
+    /**
+     * @return Whether the input ended after a complete archive and all the entries
+     *         of the path map have been renamed.
+     */
+    bool finish() const;
+
+    const std::vector<RenamedEntry> &renamedEntries() const;
+    const std::vector<Patch> &patches() const;
+
+private:
+    bool processBlock(const char *block);
+    bool processHeader(const char *block);
+    bool output(const char *data, qint64 size);
+
+    QMap<QString, QString> m_pathMap;
+    Sink m_sink;
+
+    QByteArray m_block;
+    qint64 m_offset = 0;
+    qint64 m_dataLeft = 0;
+    bool m_isAtEnd = false;
+    bool m_hasFailed = false;
+
+    // pax and GNU long name headers are held back until the header they apply to.
+    QByteArray m_extensions;
+    qint64 m_extensionsOffset = -1;
+    qint64 m_extensionLeft = 0;
+
+    QSet<QString> m_renamedPaths;
+    std::vector<RenamedEntry> m_renamedEntries;
+    std::vector<Patch> m_patches;
+};
+
+#endif // TARRENAMER_H
@@ -87,6 +87,7 @@
         "CompressionLevelMin": 1,
         "CompressionMethodDefault": "Default",
         "CompressionMethods": {
+            "Auto": "Auto",
             "BZip2": "BZip2",
             @ZIP_CM_ZSTD_JSON_LINE@
             @ZIP_CM_LZMA_JSON_LINE@
@@ -9,30 +9,43 @@
 #include "../config.h"
 #include "ark_debug.h"
 #include "queries.h"
+#include "sparsefilewriter.h"
 
 #include <KIO/Global>
 #include <KLocalizedString>
 #include <KPluginFactory>
 
-#include <QDataStream>
 #include <QDateTime>
 #include <QDir>
-#include <QDirIterator>
 #include <QFile>
 #include <QFileInfo>
+#include <QScopeGuard>
 #include <QThread>
+#include <QtEndian>
 #include <qplatformdefs.h>
 
 #include <zlib.h>
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
 #include <memory>
 
 #if !HAVE_CHRONO_CAST
 #include <utime.h>
 #endif
 
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 K_PLUGIN_CLASS_WITH_JSON(LibzipPlugin, "kerfuffle_libzip.json")
 
+// Largest amount of data read from an entry at once while extracting it.
+static const qulonglong ExtractionBufferSize = 256 * 1024;
+
 template<auto fn>
 using deleter_from_fn = std::integral_constant<decltype(fn), fn>;
 template<typename T, auto fn>
@@ -41,10 +54,19 @@ using ark_unique_ptr = std::unique_ptr<T, deleter_from_fn<fn>>;
 class ZipSource
 {
 public:
+    /**
+     * How the archive is going to be read, used to give the kernel a hint for the volumes.
+     */
+    enum class AccessPattern {
+        // Listing only touches the central directory at the end of the archive.
+        Random,
+        // Extraction and testing walk the entry data from start to end.
+        Sequential,
+    };
+
     ZipSource(const QString &fileName)
     {
-        const auto &file = m_files.emplace_back(std::make_unique<QFile>(fileName));
-        m_length = static_cast<zip_uint64_t>(file->size());
+        m_volumes.push_back(Volume{std::make_unique<QFile>(fileName)});
         m_multiVolumeName = fileName;
         zip_error_init(&m_error);
 
@@ -58,15 +80,21 @@ public:
                 if (!QFileInfo::exists(partFileName)) {
                     break;
                 }
-                const auto &part = m_files.emplace_back(std::make_unique<QFile>(partFileName));
-                m_length += static_cast<zip_uint64_t>(part->size());
+                m_volumes.push_back(Volume{std::make_unique<QFile>(partFileName)});
             }
         }
+
+        updateOffsets();
+    }
+
+    ~ZipSource()
+    {
+        close();
     }
 
     int numberOfVolumes() const
     {
-        return static_cast<int>(m_files.size());
+        return static_cast<int>(m_volumes.size());
     }
 
     QString multiVolumeName() const
@@ -74,6 +102,14 @@ public:
         return m_multiVolumeName;
     }
 
+    /**
+     * Only used for multi-volume archives, libzip reads single-volume archives itself.
+     */
+    void setAccessPattern(AccessPattern pattern)
+    {
+        m_accessPattern = pattern;
+    }
+
     zip_int64_t stat(zip_stat_t *info)
     {
         zip_stat_init(info);
@@ -99,44 +135,83 @@ public:
         return 0;
     }
 
+    zip_int64_t open()
+    {
+        // The archive may have been rewritten since the last open (e.g. after adding files), so refresh the volume sizes.
+        updateOffsets();
+        m_offset = 0;
+
+        for (auto &volume : m_volumes) {
+            if (!openVolume(volume)) {
+                zip_error_set(&m_error, ZIP_ER_OPEN, 0);
+                close();
+                return -1;
+            }
+
+#ifdef POSIX_FADV_SEQUENTIAL
+            const int advice = m_accessPattern == AccessPattern::Sequential ? POSIX_FADV_SEQUENTIAL : POSIX_FADV_RANDOM;
+            posix_fadvise(volume.file->handle(), 0, 0, advice);
+#endif
+        }
+
+        return 0;
+    }
+
+    zip_int64_t close()
+    {
+        for (auto &volume : m_volumes) {
+            volume.file->close();
+        }
+        return 0;
+    }
+
     zip_int64_t read(void *data, zip_uint64_t len)
     {
         if (len == 0 || m_offset >= m_length) {
             return 0;
         }
 
+        // Find the volume containing the current offset: the last one starting at or before it.
+        auto it = std::upper_bound(m_volumes.begin(), m_volumes.end(), m_offset, [](zip_uint64_t offset, const Volume &volume) {
+            return offset < volume.offset;
+        });
+        Q_ASSERT(it != m_volumes.begin());
+        --it;
+
         zip_int64_t ret = 0;
-        zip_uint64_t offset = m_offset;
-        for (auto &file : m_files) {
-            const auto length = static_cast<zip_uint64_t>(file->size());
-            if (offset >= length) {
-                offset -= length;
+        for (; it != m_volumes.end(); ++it) {
+            auto &volume = *it;
+            const zip_uint64_t offset = m_offset - volume.offset;
+            if (offset >= volume.size) {
                 continue;
             }
 
-            if (!file->isOpen() && !file->open(QIODevice::ReadOnly)) {
-                qCDebug(ARK_LOG) << "ZipSource error: Can't open" << file->fileName();
+            const auto available = (volume.size - offset) < len ? volume.size - offset : len;
+            if (!openVolume(volume)) {
                 break;
             }
 
-            const auto available = (length - offset) < len ? length - offset : len;
-            if (!file->seek(static_cast<qint64>(offset))) {
-                qCDebug(ARK_LOG) << "ZipSource error: Can't seek to" << available << "in file" << file->fileName();
+#ifdef Q_OS_UNIX
+            // A single syscall, which doesn't move the file position either.
+            const auto readed = pread(volume.file->handle(), data, static_cast<size_t>(available), static_cast<off_t>(offset));
+#else
+            if (!volume.file->seek(static_cast<qint64>(offset))) {
+                qCDebug(ARK_LOG) << "ZipSource error: Can't seek to" << offset << "in file" << volume.file->fileName();
                 break;
             }
 
-            const auto readed = file->read(reinterpret_cast<char *>(data), static_cast<qint64>(available));
-            if (static_cast<zip_uint64_t>(readed) != available) {
-                qCDebug(ARK_LOG) << "ZipSource error: Read" << readed << "bytes instead" << available << "in file" << file->fileName();
+            const auto readed = volume.file->read(reinterpret_cast<char *>(data), static_cast<qint64>(available));
+#endif
+            if (readed < 0 || static_cast<zip_uint64_t>(readed) != available) {
+                qCDebug(ARK_LOG) << "ZipSource error: Read" << readed << "bytes instead" << available << "in file" << volume.file->fileName();
                 break;
             }
 
             ret += static_cast<zip_int64_t>(available);
             m_offset += available;
-            offset = 0;
             len -= available;
             data = reinterpret_cast<char *>(data) + available;
-            if (len == 0) {
+            if (len == 0 || m_offset >= m_length) {
                 return ret;
             }
         }
@@ -145,6 +220,105 @@ public:
         return -1;
     }
 
+    /**
+     * Reads the local header offset of every entry from the central directory.
+     * The archive must be open. Returns an empty list if the central directory can't be parsed.
+     */
+    std::vector<zip_uint64_t> localHeaderOffsets()
+    {
+        // The end of central directory record is at the end of the archive, followed by an optional comment of up to 64 KiB.
+        const zip_uint64_t tailSize = std::min<zip_uint64_t>(m_length, 22 + 0xFFFF);
+        QByteArray tail(static_cast<qsizetype>(tailSize), Qt::Uninitialized);
+        if (!readAt(m_length - tailSize, tail.data(), tailSize)) {
+            return {};
+        }
+        const auto eocd = tail.lastIndexOf(QByteArrayLiteral("PK\x05\x06"));
+        if (eocd < 0 || eocd + 22 > tail.size()) {
+            return {};
+        }
+
+        const char *record = tail.constData() + eocd;
+        zip_uint64_t count = qFromLittleEndian<quint16>(record + 10);
+        zip_uint64_t cdirOffset = qFromLittleEndian<quint32>(record + 16);
+        if (count == 0xFFFF || cdirOffset == 0xFFFFFFFF) {
+            // Zip64: the locator right before the record points to the zip64 end of central directory record.
+            if (eocd < 20 || !tail.mid(eocd - 20, 4).startsWith(QByteArrayLiteral("PK\x06\x07"))) {
+                return {};
+            }
+            char zip64Record[56];
+            if (!readAt(qFromLittleEndian<quint64>(tail.constData() + eocd - 20 + 8), zip64Record, sizeof(zip64Record))
+                || qFromLittleEndian<quint32>(zip64Record) != 0x06064b50) {
+                return {};
+            }
+            count = qFromLittleEndian<quint64>(zip64Record + 32);
+            cdirOffset = qFromLittleEndian<quint64>(zip64Record + 48);
+        }
+
+        std::vector<zip_uint64_t> offsets;
+        offsets.reserve(static_cast<size_t>(std::min<zip_uint64_t>(count, m_length / 46)));
+        zip_uint64_t position = cdirOffset;
+        for (zip_uint64_t i = 0; i < count; ++i) {
+            char header[46];
+            if (!readAt(position, header, sizeof(header)) || qFromLittleEndian<quint32>(header) != 0x02014b50) {
+                return {};
+            }
+            const quint16 nameLength = qFromLittleEndian<quint16>(header + 28);
+            const quint16 extraLength = qFromLittleEndian<quint16>(header + 30);
+            const quint16 commentLength = qFromLittleEndian<quint16>(header + 32);
+            zip_uint64_t offset = qFromLittleEndian<quint32>(header + 42);
+
+            if (offset == 0xFFFFFFFF) {
+                // The real offset is in the zip64 extended information extra field, after the sizes that overflowed too.
+                QByteArray extra(extraLength, Qt::Uninitialized);
+                if (!readAt(position + 46 + nameLength, extra.data(), extraLength)) {
+                    return {};
+                }
+                int fieldOffset = 0;
+                while (fieldOffset + 4 <= extra.size()) {
+                    const quint16 id = qFromLittleEndian<quint16>(extra.constData() + fieldOffset);
+                    const quint16 size = qFromLittleEndian<quint16>(extra.constData() + fieldOffset + 2);
+                    if (id == 0x0001) {
+                        int valueOffset = fieldOffset + 4;
+                        valueOffset += qFromLittleEndian<quint32>(header + 24) == 0xFFFFFFFF ? 8 : 0;
+                        valueOffset += qFromLittleEndian<quint32>(header + 20) == 0xFFFFFFFF ? 8 : 0;
+                        if (valueOffset + 8 > fieldOffset + 4 + size || valueOffset + 8 > extra.size()) {
+                            return {};
+                        }
+                        offset = qFromLittleEndian<quint64>(extra.constData() + valueOffset);
+                        break;
+                    }
+                    fieldOffset += 4 + size;
+                }
+            }
+
+            offsets.push_back(offset);
+            position += 46 + nameLength + extraLength + commentLength;
+        }
+
+        return offsets;
+    }
+
+    /**
+     * Tells the kernel that the range [@p offset, @p offset + @p length) of the archive will be read soon.
+     */
+    void prefetch(zip_uint64_t offset, zip_uint64_t length)
+    {
+#ifdef POSIX_FADV_WILLNEED
+        const zip_uint64_t end = std::min(offset + length, m_length);
+        for (const auto &volume : m_volumes) {
+            if (volume.offset >= end || volume.offset + volume.size <= offset || !volume.file->isOpen()) {
+                continue;
+            }
+            const zip_uint64_t start = std::max(offset, volume.offset) - volume.offset;
+            const zip_uint64_t stop = std::min(end, volume.offset + volume.size) - volume.offset;
+            posix_fadvise(volume.file->handle(), static_cast<off_t>(start), static_cast<off_t>(stop - start), POSIX_FADV_WILLNEED);
+        }
+#else
+        Q_UNUSED(offset)
+        Q_UNUSED(length)
+#endif
+    }
+
     // Commands should return -1 on error. ZIP_SOURCE_ERROR will be called to retrieve the error code.
     // On success, commands return 0, unless specified otherwise in the description above.
     // See https://libzip.org/documentation/zip_source_function_create.html for more details.
@@ -153,11 +327,11 @@ public:
         auto source = reinterpret_cast<ZipSource *>(userdata);
         switch (cmd) {
         case ZIP_SOURCE_OPEN:
-            return 0;
+            return source->open();
         case ZIP_SOURCE_READ:
             return source->read(data, len);
         case ZIP_SOURCE_CLOSE:
-            return 0;
+            return source->close();
         case ZIP_SOURCE_STAT:
             return source->stat(reinterpret_cast<zip_stat_t *>(data));
         case ZIP_SOURCE_ERROR:
@@ -177,6 +351,10 @@ public:
         return -1;
     }
 
+    /**
+     * Opens the archive for reading. Multi-volume archives are read through @p zipSource,
+     * single-volume archives by libzip itself.
+     */
     static ark_unique_ptr<zip_t, zip_discard> create(LibzipPlugin *plugin, ZipSource &zipSource, int zipOpenFlags)
     {
         zip_error_t err;
@@ -189,6 +367,9 @@ public:
                 zip_source_free(source);
             }
         } else {
+            // The source is still read from directly (see localHeaderOffsets()), through QFile.
+            zipSource.close();
+            zipSource.updateOffsets();
             int errcode = 0;
             archive.reset(zip_open(QFile::encodeName(plugin->filename()).constData(), zipOpenFlags, &errcode));
             zip_error_init_with_code(&err, errcode);
@@ -201,11 +382,49 @@ public:
     }
 
 private:
-    std::vector<std::unique_ptr<QFile>> m_files;
+    struct Volume {
+        std::unique_ptr<QFile> file;
+        // Offset of the first byte of this volume within the whole archive.
+        zip_uint64_t offset = 0;
+        zip_uint64_t size = 0;
+    };
+
+    static bool openVolume(Volume &volume)
+    {
+        // Each read goes straight to the file, QFile's buffer would only add a copy.
+        if (!volume.file->isOpen() && !volume.file->open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            qCDebug(ARK_LOG) << "ZipSource error: Can't open" << volume.file->fileName();
+            return false;
+        }
+        return true;
+    }
+
+    bool readAt(zip_uint64_t offset, void *data, zip_uint64_t len)
+    {
+        // Don't disturb the position libzip is reading from.
+        const auto oldOffset = m_offset;
+        m_offset = offset;
+        const bool ok = read(data, len) == static_cast<zip_int64_t>(len);
+        m_offset = oldOffset;
+        return ok;
+    }
+
+    void updateOffsets()
+    {
+        m_length = 0;
+        for (auto &volume : m_volumes) {
+            volume.offset = m_length;
+            volume.size = static_cast<zip_uint64_t>(volume.file->size());
+            m_length += volume.size;
+        }
+    }
+
+    std::vector<Volume> m_volumes;
     QString m_multiVolumeName;
     zip_error_t m_error;
     zip_uint64_t m_length = 0;
     zip_uint64_t m_offset = 0;
+    AccessPattern m_accessPattern = AccessPattern::Random;
 };
 
 void LibzipPlugin::progressCallback(zip_t *, double progress, void *that)
@@ -249,6 +468,7 @@ bool LibzipPlugin::list()
     m_numberOfEntries = 0;
 
     // Open archive.
+    m_zipSource->setAccessPattern(ZipSource::AccessPattern::Random);
     auto archive = ZipSource::create(this, *m_zipSource, ZIP_RDONLY);
     if (!archive) {
         return false;
@@ -298,41 +518,34 @@ bool LibzipPlugin::addFiles(const QList<Archive::Entry *> &files,
         return false;
     }
 
+    // Directories are walked once by AddJob, which passes what it found in the options.
+    auto manifest = options.fileManifest();
+    const QStringList roots = entryFullPaths(files);
+    if (!manifest || manifest->roots() != roots) {
+        manifest = FileManifest::scan(roots);
+    }
+
     uint i = 0;
-    for (const Archive::Entry *e : files) {
+    uint unchanged = 0;
+    for (const auto &item : manifest->items()) {
         if (QThread::currentThread()->isInterruptionRequested()) {
             break;
         }
 
-        // If entry is a directory, traverse and add all its files and subfolders.
-        if (QFileInfo(e->fullPath()).isDir()) {
-            if (!writeEntry(archive.get(), e->fullPath(), destination, options, true)) {
-                return false;
-            }
-
-            QDirIterator it(e->fullPath(), QDir::AllEntries | QDir::Readable | QDir::Hidden | QDir::NoDotAndDotDot, QDirIterator::Subdirectories);
-
-            while (!QThread::currentThread()->isInterruptionRequested() && it.hasNext()) {
-                const QString path = it.next();
+        // Entries which are not replaced are copied as they are by zip_close().
+        if (options.isUpdateMode() && isUnchanged(archive.get(), item, destination)) {
+            unchanged++;
+            continue;
+        }
 
-                if (QFileInfo(path).isDir()) {
-                    if (!writeEntry(archive.get(), path, destination, options, true)) {
-                        return false;
-                    }
-                } else {
-                    if (!writeEntry(archive.get(), path, destination, options)) {
-                        return false;
-                    }
-                }
-                i++;
-            }
-        } else {
-            if (!writeEntry(archive.get(), e->fullPath(), destination, options)) {
-                return false;
-            }
+        if (!writeEntry(archive.get(), item.path, destination, options, item.isDirOrLinkToDir)) {
+            return false;
         }
         i++;
     }
+    if (unchanged > 0) {
+        qCDebug(ARK_LOG) << "Skipped" << unchanged << "unchanged files";
+    }
     qCDebug(ARK_LOG) << "Writing " << i << "entries to disk...";
 
     // Register the callback function to get progress feedback and cancelation.
@@ -446,6 +659,12 @@ bool LibzipPlugin::writeEntry(zip_t *archive, const QString &file, const Archive
 #endif
         } else if (options.compressionMethod() == QLatin1String("Store")) {
             compMethod = ZIP_CM_STORE;
+        } else if (options.compressionMethod() == QLatin1String("Auto")) {
+            // Don't waste CPU time deflating data that won't shrink anyway (images, videos, other archives...).
+            if (!isDir && isIncompressible(file)) {
+                qCDebug(ARK_LOG) << "Storing incompressible entry" << file;
+                compMethod = ZIP_CM_STORE;
+            }
         }
     }
     const int compLevel = options.isCompressionLevelSet() ? options.compressionLevel() : 6;
@@ -458,6 +677,92 @@ bool LibzipPlugin::writeEntry(zip_t *archive, const QString &file, const Archive
     return true;
 }
 
+bool LibzipPlugin::isUnchanged(zip_t *archive, const FileManifest::Item &item, const Archive::Entry *destination)
+{
+    // Existing directories are kept anyway, see writeEntry().
+    if (item.isDirOrLinkToDir) {
+        return false;
+    }
+
+    const QString file = destination ? destination->fullPath() + item.path : item.path;
+    const zip_int64_t index = zip_name_locate(archive, fromUnixSeparator(file).toUtf8().constData(), ZIP_FL_ENC_GUESS);
+    if (index == -1) {
+        return false;
+    }
+
+    zip_stat_t sb;
+    zip_stat_init(&sb);
+    if (zip_stat_index(archive, index, ZIP_FL_UNCHANGED, &sb) != 0 || !(sb.valid & ZIP_STAT_SIZE) || !(sb.valid & ZIP_STAT_MTIME)) {
+        return false;
+    }
+
+    // zip_source_file() follows symlinks, and so does QFileInfo.
+    // The DOS timestamps of zip entries have a resolution of 2 seconds.
+    const QFileInfo info(item.path);
+    return sb.size == static_cast<zip_uint64_t>(info.size()) && qAbs(info.lastModified().toSecsSinceEpoch() - qint64(sb.mtime)) < 2;
+}
+
+bool LibzipPlugin::isIncompressible(const QString &file)
+{
+    QFile f(file);
+    if (!f.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    // Only look at the first blocks of the file, that's enough to recognize the format and estimate the entropy.
+    const QByteArray sample = f.read(64 * 1024);
+    const auto data = reinterpret_cast<const uchar *>(sample.constData());
+    const auto size = sample.size();
+
+    // Magic bytes of formats which are already compressed.
+    static const QList<QByteArray> magics = {
+        QByteArrayLiteral("\xFF\xD8\xFF"), // JPEG
+        QByteArrayLiteral("\x89PNG"),
+        QByteArrayLiteral("GIF8"),
+        QByteArrayLiteral("PK\x03\x04"), // Zip and derived formats (docx, odt, jar, apk...)
+        QByteArrayLiteral("\x1F\x8B"), // gzip
+        QByteArrayLiteral("BZh"),
+        QByteArrayLiteral("\xFD" "7zXZ\x00"),
+        QByteArrayLiteral("\x28\xB5\x2F\xFD"), // zstd
+        QByteArrayLiteral("\x04\x22\x4D\x18"), // lz4
+        QByteArrayLiteral("7z\xBC\xAF\x27\x1C"),
+        QByteArrayLiteral("Rar!\x1A\x07"),
+        QByteArrayLiteral("\x1A\x45\xDF\xA3"), // Matroska and WebM
+        QByteArrayLiteral("OggS"),
+        QByteArrayLiteral("fLaC"),
+        QByteArrayLiteral("ID3"), // MP3
+    };
+    for (const QByteArray &magic : magics) {
+        if (sample.startsWith(magic)) {
+            return true;
+        }
+    }
+    // ISO base media files (MP4, MOV, HEIF, AVIF...) and WebP.
+    if ((size >= 8 && sample.mid(4, 4) == "ftyp") || (size >= 12 && sample.startsWith("RIFF") && sample.mid(8, 4) == "WEBP")) {
+        return true;
+    }
+
+    // For small samples the entropy estimate isn't meaningful, and storing them saves nothing anyway.
+    if (size < 4096) {
+        return false;
+    }
+
+    // Estimate the Shannon entropy of the sample: compressed or encrypted data is close to 8 bits per byte.
+    std::array<qint64, 256> histogram{};
+    for (qsizetype i = 0; i < size; ++i) {
+        histogram[data[i]]++;
+    }
+    double entropy = 0;
+    for (const qint64 count : histogram) {
+        if (count > 0) {
+            const double p = static_cast<double>(count) / size;
+            entropy -= p * std::log2(p);
+        }
+    }
+
+    return entropy > 7.5;
+}
+
 bool LibzipPlugin::emitEntryForIndex(zip_t *archive, qlonglong index)
 {
     Q_ASSERT(archive);
@@ -470,6 +775,7 @@ bool LibzipPlugin::emitEntryForIndex(zip_t *archive, qlonglong index)
 
     auto e = new Archive::Entry();
     auto name = toUnixSeparator(QString::fromUtf8(statBuffer.name));
+    e->setProperty("index", index);
 
     if (statBuffer.valid & ZIP_STAT_NAME) {
         e->setFullPath(name);
@@ -576,6 +882,22 @@ bool LibzipPlugin::emitEntryForIndex(zip_t *archive, qlonglong index)
     return true;
 }
 
+zip_int64_t LibzipPlugin::indexForEntry(zip_t *archive, const Archive::Entry *entry)
+{
+    const QByteArray name = fromUnixSeparator(entry->fullPath()).toUtf8();
+
+    // The index remembered while listing is only valid as long as the archive was not modified since,
+    // so make sure it still points to the same entry before trusting it.
+    if (entry->index() >= 0) {
+        const char *nameAtIndex = zip_get_name(archive, entry->index(), ZIP_FL_ENC_GUESS);
+        if (nameAtIndex && name == nameAtIndex) {
+            return entry->index();
+        }
+    }
+
+    return zip_name_locate(archive, name.constData(), ZIP_FL_ENC_GUESS);
+}
+
 bool LibzipPlugin::deleteFiles(const QList<Archive::Entry *> &files)
 {
     int errcode = 0;
@@ -596,7 +918,7 @@ bool LibzipPlugin::deleteFiles(const QList<Archive::Entry *> &files)
             break;
         }
 
-        const qlonglong index = zip_name_locate(archive.get(), fromUnixSeparator(e->fullPath()).toUtf8().constData(), ZIP_FL_ENC_GUESS);
+        const qlonglong index = indexForEntry(archive.get(), e);
         if (index == -1) {
             qCCritical(ARK_LOG) << "Could not find entry to delete:" << e->fullPath();
             Q_EMIT error(xi18n("Failed to delete entry: %1", e->fullPath()));
@@ -661,6 +983,7 @@ bool LibzipPlugin::testArchive()
     qCDebug(ARK_LOG) << "Testing archive";
 
     // Open archive performing extra consistency checks, free memory using zip_discard as no write oprations needed.
+    m_zipSource->setAccessPattern(ZipSource::AccessPattern::Sequential);
     auto archive = ZipSource::create(this, *m_zipSource, ZIP_RDONLY | ZIP_CHECKCONS);
     if (!archive) {
         return false;
@@ -713,6 +1036,7 @@ bool LibzipPlugin::extractFiles(const QList<Archive::Entry *> &files, const QStr
     const bool removeRootNode = options.isDragAndDropEnabled();
 
     // Open archive, free memory using zip_discard as no write oprations needed.
+    m_zipSource->setAccessPattern(ZipSource::AccessPattern::Sequential);
     auto archive = ZipSource::create(this, *m_zipSource, ZIP_RDONLY);
     if (!archive) {
         return false;
@@ -730,6 +1054,13 @@ bool LibzipPlugin::extractFiles(const QList<Archive::Entry *> &files, const QStr
     // Extract entries.
     m_overwriteAll = false; // Whether to overwrite all files
     m_skipAll = false; // Whether to skip all files
+    m_createdDirectories.clear();
+    m_pendingDirectories.clear();
+    // Restore directory metadata also when extraction fails half-way, like for the already written files.
+    const auto restoreDirectories = qScopeGuard([this] {
+        restoreDirectoryMetadata();
+    });
+
     if (extractAll) {
         // We extract all entries.
         for (qlonglong i = 0; i < nofEntries; i++) {
@@ -737,6 +1068,7 @@ bool LibzipPlugin::extractFiles(const QList<Archive::Entry *> &files, const QStr
                 break;
             }
             if (!extractEntry(archive.get(),
+                              i,
                               toUnixSeparator(QString::fromUtf8(zip_get_name(archive.get(), i, ZIP_FL_ENC_GUESS))),
                               QString(),
                               destinationDirectory,
@@ -748,13 +1080,50 @@ bool LibzipPlugin::extractFiles(const QList<Archive::Entry *> &files, const QStr
             Q_EMIT progress(float(i + 1) / nofEntries);
         }
     } else {
-        // We extract only the entries in files.
-        qulonglong i = 0;
+        // We extract only the entries in files. Visit them in the order they are stored in the archive
+        // rather than in selection order, so the archive is read as a (nearly) sequential stream.
+        struct WorkItem {
+            const Archive::Entry *entry;
+            zip_int64_t index;
+            zip_uint64_t offset;
+            zip_uint64_t compressedSize;
+        };
+
+        const auto offsets = m_zipSource->localHeaderOffsets();
+        const bool hasOffsets = offsets.size() == static_cast<size_t>(zip_get_num_entries(archive.get(), 0));
+        std::vector<WorkItem> workList;
+        workList.reserve(files.size());
         for (const Archive::Entry *e : files) {
+            WorkItem item{e, indexForEntry(archive.get(), e), 0, 0};
+            if (item.index >= 0) {
+                // Without the offsets fall back to the central directory order, which usually matches the data order.
+                item.offset = hasOffsets ? offsets[static_cast<size_t>(item.index)] : static_cast<zip_uint64_t>(item.index);
+                zip_stat_t statBuffer;
+                if (zip_stat_index(archive.get(), item.index, 0, &statBuffer) == 0 && (statBuffer.valid & ZIP_STAT_COMP_SIZE)) {
+                    item.compressedSize = statBuffer.comp_size;
+                }
+            }
+            workList.push_back(item);
+        }
+        std::stable_sort(workList.begin(), workList.end(), [](const WorkItem &a, const WorkItem &b) {
+            return a.offset < b.offset;
+        });
+
+        qulonglong i = 0;
+        for (auto it = workList.cbegin(); it != workList.cend(); ++it) {
             if (QThread::currentThread()->isInterruptionRequested()) {
                 break;
             }
-            if (!extractEntry(archive.get(), e->fullPath(), e->rootNode, destinationDirectory, options.preservePaths(), removeRootNode)) {
+
+            // Let the kernel read the next entry while we decompress the current one.
+            const auto next = std::next(it);
+            if (hasOffsets && next != workList.cend() && next->index >= 0) {
+                // Leave room for the local header, which has a variable size.
+                m_zipSource->prefetch(next->offset, next->compressedSize + 64 * 1024);
+            }
+
+            const Archive::Entry *e = it->entry;
+            if (!extractEntry(archive.get(), it->index, e->fullPath(), e->rootNode, destinationDirectory, options.preservePaths(), removeRootNode)) {
                 qCDebug(ARK_LOG) << "Extraction failed";
                 return false;
             }
@@ -765,7 +1134,13 @@ bool LibzipPlugin::extractFiles(const QList<Archive::Entry *> &files, const QStr
     return true;
 }
 
-bool LibzipPlugin::extractEntry(zip_t *archive, const QString &entry, const QString &rootNode, const QString &destDir, bool preservePaths, bool removeRootNode)
+bool LibzipPlugin::extractEntry(zip_t *archive,
+                                zip_int64_t index,
+                                const QString &entry,
+                                const QString &rootNode,
+                                const QString &destDir,
+                                bool preservePaths,
+                                bool removeRootNode)
 {
     const bool isDirectory = entry.endsWith(QDir::separator());
 
@@ -793,201 +1168,213 @@ bool LibzipPlugin::extractEntry(zip_t *archive, const QString &entry, const QStr
         destination = destDirCorrected + QFileInfo(entry).fileName();
     }
 
-    // Store parent mtime.
-    QString parentDir;
-    if (isDirectory) {
-        QDir pDir = QFileInfo(destination).dir();
-        pDir.cdUp();
-        parentDir = pDir.path();
-    } else {
-        parentDir = QFileInfo(destination).path();
-    }
-    // For top-level items, don't restore parent dir mtime.
-    const bool restoreParentMtime = (parentDir + QDir::separator() != destDirCorrected);
-
-    std::filesystem::file_time_type parent_mtime;
-    std::error_code error_code;
-    if (restoreParentMtime) {
-        parent_mtime = std::filesystem::last_write_time(QFileInfo(parentDir).filesystemAbsoluteFilePath(), error_code);
-        if (error_code) {
-            qCWarning(ARK_LOG) << "Failed to read parent modtime" << error_code.message();
-        }
-    }
-
     // Create parent directories for files. For directories create them.
-    if (!QDir().mkpath(QFileInfo(destination).path())) {
-        qCDebug(ARK_LOG) << "Failed to create directory:" << QFileInfo(destination).path();
-        Q_EMIT error(xi18n("Failed to create directory: %1", QFileInfo(destination).path()));
-        return false;
+    // Many entries share the same parent, so remember which directories already exist.
+    const QString destinationDir = QFileInfo(destination).path();
+    if (!m_createdDirectories.contains(destinationDir)) {
+        if (!QDir().mkpath(destinationDir)) {
+            qCDebug(ARK_LOG) << "Failed to create directory:" << destinationDir;
+            Q_EMIT error(xi18n("Failed to create directory: %1", destinationDir));
+            return false;
+        }
+        m_createdDirectories.insert(destinationDir);
     }
 
     // Get statistic for entry. Used to get entry size and mtime.
-    zip_stat_t statBuffer;
-    if (zip_stat(archive, fromUnixSeparator(entry).toUtf8().constData(), 0, &statBuffer) != 0) {
-        if (isDirectory && zip_error_code_zip(zip_get_error(archive)) == ZIP_ER_NOENT) {
+    if (index == -1) {
+        if (isDirectory) {
             qCWarning(ARK_LOG) << "Skipping folder without entry:" << entry;
             return true;
         }
+        qCCritical(ARK_LOG) << "Could not locate entry:" << entry;
+        Q_EMIT error(xi18n("Failed to locate entry: %1", entry));
+        return false;
+    }
+
+    zip_stat_t statBuffer;
+    if (zip_stat_index(archive, index, 0, &statBuffer) != 0) {
         qCCritical(ARK_LOG) << "Failed to read stat for entry" << entry;
         return false;
     }
 
-    if (!isDirectory) {
-        // Handle existing destination files.
-        QString renamedEntry = entry;
-        while (!m_overwriteAll && QFileInfo::exists(destination)) {
-            if (m_skipAll) {
-                return true;
-            } else {
-                Kerfuffle::OverwriteQuery query(renamedEntry);
-                query.setArchiveFileName(filename());
-                query.setArchiveMimeType(mimetype().name());
-                query.setDestination(destination);
-                Q_EMIT userQuery(&query);
-                query.waitForResponse();
-
-                if (query.responseCancelled()) {
-                    Q_EMIT cancelled();
-                    return false;
-                } else if (query.responseSkip()) {
-                    return true;
-                } else if (query.responseAutoSkip()) {
-                    m_skipAll = true;
-                    return true;
-                } else if (query.responseRename()) {
-                    const QString newName(query.newFilename());
-                    destination = QFileInfo(destination).path() + QDir::separator() + QFileInfo(newName).fileName();
-                    renamedEntry = QFileInfo(entry).path() + QDir::separator() + QFileInfo(newName).fileName();
-                } else if (query.responseOverwriteAll()) {
-                    m_overwriteAll = true;
-                    break;
-                } else if (query.responseOverwrite()) {
-                    break;
-                }
-            }
-        }
+    zip_uint8_t opsys;
+    zip_uint32_t attributes;
+    if (zip_file_get_external_attributes(archive, index, ZIP_FL_UNCHANGED, &opsys, &attributes) == -1) {
+        qCCritical(ARK_LOG) << "Could not read external attributes for entry:" << entry;
+        Q_EMIT error(xi18n("Failed to read metadata for entry: %1", entry));
+        return false;
+    }
 
-        // Handle password-protected files.
-        ark_unique_ptr<zip_file, zip_fclose> zipFile{nullptr};
-        bool firstTry = true;
-        while (!zipFile) {
-            zipFile.reset(zip_fopen(archive, fromUnixSeparator(entry).toUtf8().constData(), 0));
-            if (zipFile) {
-                break;
-            } else if (zip_error_code_zip(zip_get_error(archive)) == ZIP_ER_NOPASSWD || zip_error_code_zip(zip_get_error(archive)) == ZIP_ER_WRONGPASSWD) {
-                Kerfuffle::PasswordNeededQuery query(filename(), !firstTry);
-                Q_EMIT userQuery(&query);
-                query.waitForResponse();
-
-                if (query.responseCancelled()) {
-                    Q_EMIT cancelled();
-                    return false;
-                }
-                setPassword(query.password());
+    if (isDirectory) {
+        // Writing the entries inside the directory would change its mtime again,
+        // so its metadata is restored once everything has been extracted.
+        m_pendingDirectories.push_back({destinationDir, statBuffer.mtime, opsys, attributes});
+        return true;
+    }
 
-                if (zip_set_default_password(archive, password().toUtf8().constData())) {
-                    qCDebug(ARK_LOG) << "Failed to set password for:" << entry;
-                }
-                firstTry = false;
-            } else {
-                qCCritical(ARK_LOG) << "Failed to open file:" << zip_strerror(archive);
-                Q_EMIT error(xi18n("Failed to open '%1':<nl/>%2", entry, QString::fromUtf8(zip_strerror(archive))));
+    // Handle existing destination files.
+    QString renamedEntry = entry;
+    while (!m_overwriteAll && QFileInfo::exists(destination)) {
+        if (m_skipAll) {
+            return true;
+        } else {
+            Kerfuffle::OverwriteQuery query(renamedEntry);
+            query.setArchiveFileName(filename());
+            query.setArchiveMimeType(mimetype().name());
+            query.setDestination(destination);
+            Q_EMIT userQuery(&query);
+            query.waitForResponse();
+
+            if (query.responseCancelled()) {
+                Q_EMIT cancelled();
                 return false;
+            } else if (query.responseSkip()) {
+                return true;
+            } else if (query.responseAutoSkip()) {
+                m_skipAll = true;
+                return true;
+            } else if (query.responseRename()) {
+                const QString newName(query.newFilename());
+                destination = QFileInfo(destination).path() + QDir::separator() + QFileInfo(newName).fileName();
+                renamedEntry = QFileInfo(entry).path() + QDir::separator() + QFileInfo(newName).fileName();
+            } else if (query.responseOverwriteAll()) {
+                m_overwriteAll = true;
+                break;
+            } else if (query.responseOverwrite()) {
+                break;
             }
         }
+    }
 
-        QFile file(destination);
-        if (!file.open(QIODevice::WriteOnly)) {
-            qCCritical(ARK_LOG) << "Failed to open file for writing";
-            Q_EMIT error(xi18n("Failed to open file for writing: %1", destination));
-            return false;
-        }
-
-        QDataStream out(&file);
+    // Handle password-protected files.
+    ark_unique_ptr<zip_file, zip_fclose> zipFile{nullptr};
+    bool firstTry = true;
+    while (!zipFile) {
+        zipFile.reset(zip_fopen_index(archive, index, 0));
+        if (zipFile) {
+            break;
+        } else if (zip_error_code_zip(zip_get_error(archive)) == ZIP_ER_NOPASSWD || zip_error_code_zip(zip_get_error(archive)) == ZIP_ER_WRONGPASSWD) {
+            Kerfuffle::PasswordNeededQuery query(filename(), !firstTry);
+            Q_EMIT userQuery(&query);
+            query.waitForResponse();
 
-        // Write archive entry to file. We use a read/write buffer of 1000 chars.
-        qulonglong sum = 0;
-        char buf[1000];
-        while (sum != statBuffer.size) {
-            const auto readBytes = zip_fread(zipFile.get(), buf, 1000);
-            if (readBytes < 0) {
-                qCCritical(ARK_LOG) << "Failed to read data";
-                Q_EMIT error(xi18n("Failed to read data for entry: %1", entry));
-                return false;
-            }
-            if (out.writeRawData(buf, readBytes) != readBytes) {
-                qCCritical(ARK_LOG) << "Failed to write data";
-                Q_EMIT error(xi18n("Failed to write data for entry: %1", entry));
+            if (query.responseCancelled()) {
+                Q_EMIT cancelled();
                 return false;
             }
+            setPassword(query.password());
 
-            sum += readBytes;
+            if (zip_set_default_password(archive, password().toUtf8().constData())) {
+                qCDebug(ARK_LOG) << "Failed to set password for:" << entry;
+            }
+            firstTry = false;
+        } else {
+            qCCritical(ARK_LOG) << "Failed to open file:" << zip_strerror(archive);
+            Q_EMIT error(xi18n("Failed to open '%1':<nl/>%2", entry, QString::fromUtf8(zip_strerror(archive))));
+            return false;
         }
+    }
 
-        const auto index = zip_name_locate(archive, fromUnixSeparator(entry).toUtf8().constData(), ZIP_FL_ENC_GUESS);
-        if (index == -1) {
-            qCCritical(ARK_LOG) << "Could not locate entry:" << entry;
-            Q_EMIT error(xi18n("Failed to locate entry: %1", entry));
+    QFile file(destination);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qCCritical(ARK_LOG) << "Failed to open file for writing";
+        Q_EMIT error(xi18n("Failed to open file for writing: %1", destination));
+        return false;
+    }
+
+    // Write archive entry to file, preallocated and leaving holes for blocks of zeros.
+    SparseFileWriter writer(&file, static_cast<qint64>(statBuffer.size));
+    qulonglong sum = 0;
+    QByteArray buf(static_cast<qsizetype>(std::min<qulonglong>(statBuffer.size, ExtractionBufferSize)), Qt::Uninitialized);
+    while (sum != statBuffer.size) {
+        const auto readBytes = zip_fread(zipFile.get(), buf.data(), buf.size());
+        if (readBytes < 0) {
+            qCCritical(ARK_LOG) << "Failed to read data";
+            Q_EMIT error(xi18n("Failed to read data for entry: %1", entry));
             return false;
         }
-
-        zip_uint8_t opsys;
-        zip_uint32_t attributes;
-        if (zip_file_get_external_attributes(archive, index, ZIP_FL_UNCHANGED, &opsys, &attributes) == -1) {
-            qCCritical(ARK_LOG) << "Could not read external attributes for entry:" << entry;
-            Q_EMIT error(xi18n("Failed to read metadata for entry: %1", entry));
+        if (!writer.write(buf.constData(), readBytes)) {
+            qCCritical(ARK_LOG) << "Failed to write data";
+            Q_EMIT error(xi18n("Failed to write data for entry: %1", entry));
             return false;
         }
 
-        // Inspired by fuse-zip source code: fuse-zip/lib/fileNode.cpp
-        switch (opsys) {
-        case ZIP_OPSYS_UNIX:
-            if (attributes != 0) {
-                // Unix permissions are stored in the leftmost 16 bits of the external file attribute.
-                file.setPermissions(KIO::convertPermissions(attributes >> 16));
-            }
-            break;
-        default: // TODO: non-UNIX.
-            break;
-        }
+        sum += readBytes;
+    }
+    if (!writer.finish()) {
+        qCCritical(ARK_LOG) << "Failed to write data";
+        Q_EMIT error(xi18n("Failed to write data for entry: %1", entry));
+        return false;
+    }
 
-        file.close();
+    // Inspired by fuse-zip source code: fuse-zip/lib/fileNode.cpp
+    switch (opsys) {
+    case ZIP_OPSYS_UNIX:
+        if (attributes != 0) {
+            // Unix permissions are stored in the leftmost 16 bits of the external file attribute.
+            file.setPermissions(KIO::convertPermissions(attributes >> 16));
+        }
+        break;
+    default: // TODO: non-UNIX.
+        break;
     }
 
+    file.close();
+
+    setMtime(destination, statBuffer.mtime);
+    return true;
+}
+
+void LibzipPlugin::setMtime(const QString &path, time_t mtime)
+{
     // Set mtime for entry (also access time otherwise it's "uninitilized")
 #if HAVE_CHRONO_CAST
-    const auto time = std::chrono::clock_cast<std::chrono::file_clock>(std::chrono::system_clock::from_time_t(statBuffer.mtime));
-    std::filesystem::last_write_time(QFileInfo(destination).filesystemAbsoluteFilePath(), time, error_code);
+    std::error_code error_code;
+    const auto time = std::chrono::clock_cast<std::chrono::file_clock>(std::chrono::system_clock::from_time_t(mtime));
+    std::filesystem::last_write_time(QFileInfo(path).filesystemAbsoluteFilePath(), time, error_code);
     if (error_code) {
-        qCWarning(ARK_LOG) << "Failed to restore mtime:" << destination << error_code.message();
+        qCWarning(ARK_LOG) << "Failed to restore mtime:" << path << error_code.message();
     }
 #else
     utimbuf times;
-    times.actime = statBuffer.mtime;
-    times.modtime = statBuffer.mtime;
-    if (utime(destination.toUtf8().constData(), &times) != 0) {
-        qCWarning(ARK_LOG) << "Failed to restore mtime:" << destination;
+    times.actime = mtime;
+    times.modtime = mtime;
+    if (utime(path.toUtf8().constData(), &times) != 0) {
+        qCWarning(ARK_LOG) << "Failed to restore mtime:" << path;
     }
 #endif
 
     Q_ASSERT([&] {
-        const auto mtime = QDateTime::fromSecsSinceEpoch(statBuffer.mtime);
-        const auto actualMtime = QFileInfo(destination).fileTime(QFile::FileModificationTime);
-        if (mtime != actualMtime) {
-            qDebug() << "Target mtime:" << mtime << "Actual mtime:" << actualMtime;
+        const auto expectedMtime = QDateTime::fromSecsSinceEpoch(mtime);
+        const auto actualMtime = QFileInfo(path).fileTime(QFile::FileModificationTime);
+        if (expectedMtime != actualMtime) {
+            qDebug() << "Target mtime:" << expectedMtime << "Actual mtime:" << actualMtime;
             return false;
         }
         return true;
     }());
+}
 
-    if (restoreParentMtime) {
-        // Restore mtime for parent dir.
-        std::filesystem::last_write_time(QFileInfo(parentDir).filesystemAbsoluteFilePath(), parent_mtime, error_code);
-        if (error_code) {
-            qCWarning(ARK_LOG) << "Failed to restore mtime for parent dir of:" << destination << error_code.message();
+void LibzipPlugin::restoreDirectoryMetadata()
+{
+    // Post-order: handle subdirectories before their parents, since changing a directory
+    // (including its permissions) may update the mtime of the parent.
+    std::sort(m_pendingDirectories.begin(), m_pendingDirectories.end(), [](const PendingDirectory &a, const PendingDirectory &b) {
+        return a.path > b.path;
+    });
+
+    for (const auto &dir : std::as_const(m_pendingDirectories)) {
+        if (dir.opsys == ZIP_OPSYS_UNIX && dir.attributes != 0) {
+            // Unix permissions are stored in the leftmost 16 bits of the external file attribute.
+            if (!QFile::setPermissions(dir.path, KIO::convertPermissions(dir.attributes >> 16))) {
+                qCWarning(ARK_LOG) << "Failed to restore permissions:" << dir.path;
+            }
         }
+        setMtime(dir.path, dir.mtime);
     }
-    return true;
+
+    m_pendingDirectories.clear();
+    m_createdDirectories.clear();
 }
 
 bool LibzipPlugin::moveFiles(const QList<Archive::Entry *> &files, Archive::Entry *destination, const CompressionOptions &options)
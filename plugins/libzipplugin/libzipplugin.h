@@ -8,9 +8,14 @@
 #define LIBZIPPLUGIN_H
 
 #include "archiveinterface.h"
+#include "filemanifest.h"
+
+#include <QSet>
 
 #include <zip.h>
 
+#include <vector>
+
 using namespace Kerfuffle;
 
 class ZipSource;
@@ -42,16 +47,37 @@ public:
     QString multiVolumeName() const override;
 
 private:
-    bool extractEntry(zip_t *archive, const QString &entry, const QString &rootNode, const QString &destDir, bool preservePaths, bool removeRootNode);
+    struct PendingDirectory {
+        QString path;
+        time_t mtime;
+        zip_uint8_t opsys;
+        zip_uint32_t attributes;
+    };
+
+    bool extractEntry(zip_t *archive,
+                      zip_int64_t index,
+                      const QString &entry,
+                      const QString &rootNode,
+                      const QString &destDir,
+                      bool preservePaths,
+                      bool removeRootNode);
     bool writeEntry(zip_t *archive, const QString &entry, const Archive::Entry *destination, const CompressionOptions &options, bool isDir = false);
+    bool isUnchanged(zip_t *archive, const FileManifest::Item &item, const Archive::Entry *destination);
     bool emitEntryForIndex(zip_t *archive, qlonglong index);
+    zip_int64_t indexForEntry(zip_t *archive, const Archive::Entry *entry);
+    void setMtime(const QString &path, time_t mtime);
+    void restoreDirectoryMetadata();
     void emitProgress(double percentage);
+    static bool isIncompressible(const QString &file);
     QString fromUnixSeparator(const QString &path);
     QString toUnixSeparator(const QString &path);
     static void progressCallback(zip_t *, double progress, void *that);
     static int cancelCallback(zip_t *, void *that);
 
     QList<Archive::Entry *> m_emittedEntries;
+    // Directories created or restored by the current extraction.
+    QSet<QString> m_createdDirectories;
+    std::vector<PendingDirectory> m_pendingDirectories;
     bool m_overwriteAll;
     bool m_skipAll;
     bool m_listAfterAdd;